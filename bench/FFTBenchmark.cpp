@@ -0,0 +1,120 @@
+// Times the stretch's real FFT at the sizes presetDefault() and presetCheaper() configure,
+// with whichever backend this executable was built against. Each backend gets its own
+// executable (the backend is a compile-time specialisation), and they print the same table,
+// so their runs can be put side by side:
+//
+//     fft-benchmark-bundled  > bundled.txt
+//     fft-benchmark-stockham > stockham.txt
+
+#include <stft.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#ifndef DERANGER_FFT_BACKEND_NAME
+#define DERANGER_FFT_BACKEND_NAME "bundled"
+#endif
+
+namespace
+{
+    // The stretch's STFT type; only its splitComputation flag differs between the presets
+    template <bool splitComputation>
+    using StretchSTFT = signalsmith::linear::DynamicSTFT<float, splitComputation, true>;
+
+    struct Preset
+    {
+        const char* name;
+        double blockSeconds, intervalSeconds;
+        bool splitComputation;
+    };
+
+    // Mirrors SignalsmithStretch::presetDefault() and presetCheaper()
+    constexpr Preset presets[] = {
+        { "default", 0.12, 0.03, false },
+        { "cheaper", 0.1,  0.04, true  },
+    };
+
+    constexpr double sampleRates[] = { 44100.0, 48000.0, 96000.0 };
+
+    struct Result
+    {
+        double medianMicroseconds, worstMicroseconds, roundTripError;
+    };
+
+    // One forward and one inverse transform per repetition, as the stretch does per channel
+    template <bool splitComputation>
+    Result timeTransforms(size_t fftSize, int repetitions)
+    {
+        signalsmith::linear::RealFFT<float, splitComputation, true> fft(fftSize);
+
+        std::vector<float> time(fftSize), roundTrip(fftSize);
+        std::vector<std::complex<float>> spectrum(fftSize / 2);
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+        for (auto& sample : time)
+            sample = noise(random);
+
+        std::vector<double> timings;
+        timings.reserve(static_cast<size_t>(repetitions));
+        for (int rep = 0; rep < repetitions; ++rep)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            fft.fft(time.data(), spectrum.data());
+            fft.ifft(spectrum.data(), roundTrip.data());
+            timings.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        double error = 0.0;
+        for (size_t i = 0; i < fftSize; ++i)
+            error = std::max(error, static_cast<double>(std::abs(roundTrip[i] / static_cast<float>(fftSize) - time[i])));
+
+        std::sort(timings.begin(), timings.end());
+        return { timings[timings.size() / 2], timings.back(), error };
+    }
+
+    template <bool splitComputation>
+    size_t stftSize(double sampleRate, const Preset& preset)
+    {
+        const auto blockSamples = static_cast<int>(sampleRate * preset.blockSeconds);
+        const auto intervalSamples = static_cast<int>(sampleRate * preset.intervalSeconds);
+
+        StretchSTFT<splitComputation> stft;
+        stft.configure(1, 1, static_cast<size_t>(blockSamples), static_cast<size_t>(intervalSamples + 1));
+        return stft.fftSamples();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+
+    std::printf("backend %s, %d repetitions, forward + inverse per repetition\n", DERANGER_FFT_BACKEND_NAME, repetitions);
+    std::printf("%-8s %7s %6s %12s %12s %14s %12s\n",
+                "preset", "rate", "size", "median us", "worst us", "stereo % cpu", "round trip");
+
+    for (const auto& preset : presets)
+    {
+        for (const auto sampleRate : sampleRates)
+        {
+            const auto fftSize = preset.splitComputation ? stftSize<true>(sampleRate, preset)
+                                                         : stftSize<false>(sampleRate, preset);
+            const auto result = preset.splitComputation ? timeTransforms<true>(fftSize, repetitions)
+                                                        : timeTransforms<false>(fftSize, repetitions);
+
+            // Two channels, one analysis and synthesis per interval
+            const auto intervalsPerSecond = 1.0 / preset.intervalSeconds;
+            const auto cpuPercent = result.medianMicroseconds * 2.0 * intervalsPerSecond * 1e-4;
+
+            std::printf("%-8s %7.0f %6zu %12.2f %12.2f %14.3f %12.2e\n",
+                        preset.name, sampleRate, fftSize, result.medianMicroseconds,
+                        result.worstMicroseconds, cpuPercent, result.roundTripError);
+        }
+    }
+
+    return 0;
+}
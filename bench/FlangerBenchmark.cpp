@@ -0,0 +1,124 @@
+// Times FlangerProcessor::process() per host block, stereo at 48 kHz, for each delay-line
+// interpolation kernel, with and without through-zero. Depth and feedback are up and the
+// centre delay is swept, so the kernels see a moving fractional delay and the smoothers ramp.
+//
+//     flanger-benchmark [blocks per run]
+
+#include <JuceHeader.h>
+#include "effects/FlangerProcessor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using Flanger = FlangerProcessor<float>;
+
+    struct Kernel
+    {
+        const char* name;
+        Flanger::Interpolation interpolation;
+    };
+
+    constexpr Kernel kernels[] = {
+        { "linear",   Flanger::Interpolation::Linear },
+        { "lagrange", Flanger::Interpolation::Lagrange },
+        { "thiran",   Flanger::Interpolation::Allpass },
+    };
+
+    constexpr int blockSizes[] = { 64, 256, 512 };
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 2;
+
+    struct Result
+    {
+        double meanMicroseconds, medianMicroseconds, worstMicroseconds;
+    };
+
+    Result timeBlocks(const Kernel& kernel, bool throughZero, int blockSize, int numBlocks)
+    {
+        DelayArena arena;
+        Flanger flanger;
+        flanger.setDelayArena(&arena);
+        flanger.setInterpolation(kernel.interpolation);
+        flanger.setThroughZero(throughZero);
+        flanger.setLFODepth(0.8f);
+        flanger.setFeedback(0.6f);
+
+        const juce::dsp::ProcessSpec spec { sampleRate, static_cast<juce::uint32>(blockSize), static_cast<juce::uint32>(numChannels) };
+        arena.beginLayout(sampleRate);
+        flanger.prepare(spec);
+        arena.endLayout();
+
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+        long position = 0;
+
+        // Half a second first, so the delay line is full and caches are warm
+        const int warmUpBlocks = static_cast<int>(0.5 * sampleRate) / blockSize;
+
+        std::vector<double> timings;
+        timings.reserve(static_cast<size_t>(numBlocks));
+        for (int block = 0; block < warmUpBlocks + numBlocks; ++block)
+        {
+            for (int i = 0; i < blockSize; ++i, ++position)
+            {
+                const auto tone = 0.3f * std::sin(static_cast<float>(position) * 0.031f);
+                buffer.setSample(0, i, tone + noise(random));
+                buffer.setSample(1, i, tone * 0.5f + noise(random));
+            }
+
+            // A new centre delay every 50 ms or so
+            if (block % juce::jmax(1, static_cast<int>(0.05 * sampleRate) / blockSize) == 0)
+                flanger.setDelay(2.0f + 8.0f * static_cast<float>((block / 7) % 3) / 2.0f);
+
+            juce::dsp::AudioBlock<float> audioBlock(buffer);
+
+            const auto start = std::chrono::steady_clock::now();
+            flanger.process(audioBlock);
+            const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            if (block >= warmUpBlocks)
+                timings.push_back(elapsed);
+        }
+
+        double total = 0.0;
+        for (const auto t : timings)
+            total += t;
+
+        std::sort(timings.begin(), timings.end());
+        return { total / static_cast<double>(timings.size()), timings[timings.size() / 2], timings.back() };
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int numBlocks = argc > 1 ? std::max(1, std::atoi(argv[1])) : 4000;
+
+    std::printf("stereo, %.0f Hz, depth 0.8, feedback 0.6, %d blocks per run\n", sampleRate, numBlocks);
+    std::printf("%-9s %6s %6s %10s %10s %10s %12s\n", "kernel", "tz", "block", "mean us", "median us", "worst us", "mean % cpu");
+
+    for (const auto& kernel : kernels)
+    {
+        for (const bool throughZero : { false, true })
+        {
+            for (const auto blockSize : blockSizes)
+            {
+                const auto result = timeBlocks(kernel, throughZero, blockSize, numBlocks);
+                const auto blockMicroseconds = 1e6 * blockSize / sampleRate;
+
+                std::printf("%-9s %6s %6d %10.2f %10.2f %10.2f %12.2f\n",
+                            kernel.name, throughZero ? "yes" : "no", blockSize, result.meanMicroseconds, result.medianMicroseconds,
+                            result.worstMicroseconds, 100.0 * result.meanMicroseconds / blockMicroseconds);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Times SignalsmithStretch::process() per host block, stereo at 48 kHz, at the block sizes hosts
+// usually run us at. The stretch does its spectral work in steps spread across the blocks of one
+// interval, so the median shows the steady cost and the worst block shows what's left of the spikes.
+// Each preset runs with the channels analysed separately and linked through their mid.
+//
+//     stretch-benchmark [blocks per run]
+
+#include <signalsmith-stretch.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using Stretch = signalsmith::stretch::SignalsmithStretch<float, std::minstd_rand>;
+
+    struct Preset
+    {
+        const char* name;
+        double blockSeconds, intervalSeconds;
+        bool splitComputation;
+    };
+
+    // Mirrors SignalsmithStretch::presetDefault() and presetCheaper()
+    constexpr Preset presets[] = {
+        { "default", 0.12, 0.03, false },
+        { "cheaper", 0.1,  0.04, true  },
+    };
+
+    constexpr int blockSizes[] = { 64, 128, 256, 512 };
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 2;
+
+    struct Result
+    {
+        double meanMicroseconds, medianMicroseconds, worstMicroseconds;
+    };
+
+    Result timeBlocks(const Preset& preset, bool linked, int blockSize, int numBlocks)
+    {
+        Stretch stretch(1);
+        stretch.setLinkedChannels(linked);
+        stretch.configure(numChannels, static_cast<int>(sampleRate * preset.blockSeconds),
+                          static_cast<int>(sampleRate * preset.intervalSeconds), preset.splitComputation);
+        // Pitch-shifted, so the peak-finding and frequency-map steps run too
+        stretch.setTransposeSemitones(7.0f);
+
+        std::vector<std::vector<float>> input(numChannels, std::vector<float>(static_cast<size_t>(blockSize)));
+        std::vector<std::vector<float>> output(input);
+        std::vector<float*> inputPointers, outputPointers;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            inputPointers.push_back(input[static_cast<size_t>(ch)].data());
+            outputPointers.push_back(output[static_cast<size_t>(ch)].data());
+        }
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+        long position = 0;
+
+        // A couple of seconds first, so the timing starts with the engine full and caches warm
+        const int warmUpBlocks = static_cast<int>(2.0 * sampleRate) / blockSize;
+
+        std::vector<double> timings;
+        timings.reserve(static_cast<size_t>(numBlocks));
+        for (int block = 0; block < warmUpBlocks + numBlocks; ++block)
+        {
+            for (int i = 0; i < blockSize; ++i, ++position)
+            {
+                const auto tone = 0.3f * std::sin(static_cast<float>(position) * 0.031f);
+                input[0][static_cast<size_t>(i)] = tone + noise(random);
+                input[1][static_cast<size_t>(i)] = tone * 0.5f + noise(random);
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            stretch.process(inputPointers.data(), blockSize, outputPointers.data(), blockSize);
+            const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            if (block >= warmUpBlocks)
+                timings.push_back(elapsed);
+        }
+
+        double total = 0.0;
+        for (const auto t : timings)
+            total += t;
+
+        std::sort(timings.begin(), timings.end());
+        return { total / static_cast<double>(timings.size()), timings[timings.size() / 2], timings.back() };
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int numBlocks = argc > 1 ? std::max(1, std::atoi(argv[1])) : 4000;
+
+    std::printf("stereo, %.0f Hz, +7 semitones, %d blocks per run\n", sampleRate, numBlocks);
+    std::printf("%-8s %6s %6s %10s %10s %10s %12s\n", "preset", "linked", "block", "mean us", "median us", "worst us", "mean % cpu");
+
+    for (const auto& preset : presets)
+    {
+        for (const bool linked : { false, true })
+        {
+            for (const auto blockSize : blockSizes)
+            {
+                const auto result = timeBlocks(preset, linked, blockSize, numBlocks);
+                const auto blockMicroseconds = 1e6 * blockSize / sampleRate;
+
+                std::printf("%-8s %6s %6d %10.2f %10.2f %10.2f %12.2f\n",
+                            preset.name, linked ? "yes" : "no", blockSize, result.meanMicroseconds, result.medianMicroseconds,
+                            result.worstMicroseconds, 100.0 * result.meanMicroseconds / blockMicroseconds);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -4,6 +4,8 @@
 #include <complex>
 #include <vector>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 
 #if defined(__FAST_MATH__) && (__apple_build_version__ >= 16000000) && (__apple_build_version__ <= 16000099) && !defined(SIGNALSMITH_IGNORE_BROKEN_APPLECLANG)
 #	error Apple Clang 16.0.0 generates incorrect SIMD for ARM. If you HAVE to use this version of Clang, turn off -ffast-math.
@@ -13,6 +15,26 @@
 #	define M_PI 3.14159265358979323846
 #endif
 
+// Vector kernels for the split-complex passes, picked at runtime; define SIGNALSMITH_NO_X86_SIMD to opt out
+#if !defined(SIGNALSMITH_NO_X86_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#	include "./platform/fft-x86.h"
+#else
+namespace signalsmith { namespace linear { namespace _impl { namespace simd {
+	template<class S>
+	bool radix2(size_t, const S *, const S *, S *, S *) {
+		return false;
+	}
+	template<class S>
+	bool radix4(bool, size_t, const S *, const S *, S *, S *, size_t, const std::complex<S> &, const std::complex<S> &, const std::complex<S> &) {
+		return false;
+	}
+	template<class S>
+	size_t complexMul(bool, S *, S *, const S *, const S *, const S *, const S *, size_t) {
+		return 0;
+	}
+}}}} // namespace
+#endif
+
 namespace signalsmith { namespace linear {
 
 namespace _impl {
@@ -32,7 +54,7 @@ namespace _impl {
 	}
 	template<class V>
 	void complexMul(V *ar, V *ai, const V *br, const V *bi, const V *cr, const V *ci, size_t size) {
-		for (size_t i = 0; i < size; ++i) {
+		for (size_t i = simd::complexMul(false, ar, ai, br, bi, cr, ci, size); i < size; ++i) {
 			V rr = br[i]*cr[i] - bi[i]*ci[i];
 			V ri = br[i]*ci[i] + bi[i]*cr[i];
 			ar[i] = rr;
@@ -41,7 +63,7 @@ namespace _impl {
 	}
 	template<class V>
 	void complexMulConj(V *ar, V *ai, const V *br, const V *bi, const V *cr, const V *ci, size_t size) {
-		for (size_t i = 0; i < size; ++i) {
+		for (size_t i = simd::complexMul(true, ar, ai, br, bi, cr, ci, size); i < size; ++i) {
 			V rr = cr[i]*br[i] + ci[i]*bi[i];
 			V ri = cr[i]*bi[i] - ci[i]*br[i];
 			ar[i] = rr;
@@ -233,6 +255,7 @@ private:
 			combine4<inverse>(4, stride, inputR, inputI, outputR, outputI);
 		} else {
 			// 2-point FFT
+			if (_impl::simd::radix2(stride, inputR, inputI, outputR, outputI)) return;
 			for (size_t s = 0; s < stride; ++s) {
 				Sample ar = inputR[s], ai = inputI[s];
 				Sample br = inputR[s + stride], bi = inputI[s + stride];
@@ -252,6 +275,7 @@ private:
 			Complex twiddleB = twiddles[i*twiddleStep];
 			Complex twiddleC = twiddles[i*2*twiddleStep];
 			Complex twiddleD = twiddles[i*3*twiddleStep];
+			if (_impl::simd::radix4(inverse, stride, inputR + 4*i*stride, inputI + 4*i*stride, outputR + i*stride, outputI + i*stride, size/4*stride, twiddleB, twiddleC, twiddleD)) continue;
 			
 			const Sample *inputAr = inputR + 4*i*stride, *inputAi = inputI + 4*i*stride;
 			const Sample *inputBr = inputR + (4*i + 1)*stride, *inputBi = inputI + (4*i + 1)*stride;
@@ -1354,6 +1378,44 @@ private:
 template<typename Sample, bool splitComputation=false>
 using ModifiedRealFFT = RealFFT<Sample, splitComputation, true>;
 
+/// Runs split-complex FFTs (forward and inverse, with radix-2 and radix-4 inner passes) with the vector kernels and again with the scalar reference, and checks they agree. Not real-time safe.
+template<typename Sample>
+bool simdMatchesReference() {
+#ifdef SIGNALSMITH_AUDIO_LINEAR_FFT_X86_H
+	auto &level = _impl::simd::level();
+	const auto detected = level.load();
+	bool matches = true;
+	for (size_t size : {768, 1536}) {
+		SplitFFT<Sample> fft(size);
+		std::vector<Sample> inR(size), inI(size), vectorR(size), vectorI(size), scalarR(size), scalarI(size);
+		for (size_t i = 0; i < size; ++i) {
+			inR[i] = Sample(std::sin(0.37*i) + 0.25*std::cos(1.9*i*i));
+			inI[i] = Sample(std::cos(0.11*i*i) - 0.5*std::sin(2.3*i));
+		}
+		for (bool inverse : {false, true}) {
+			level.store(detected);
+			if (inverse) fft.ifft(inR.data(), inI.data(), vectorR.data(), vectorI.data());
+			else fft.fft(inR.data(), inI.data(), vectorR.data(), vectorI.data());
+			level.store(_impl::simd::Level::scalar);
+			if (inverse) fft.ifft(inR.data(), inI.data(), scalarR.data(), scalarI.data());
+			else fft.fft(inR.data(), inI.data(), scalarR.data(), scalarI.data());
+			
+			// Only fused multiply-adds (if the compiler contracts the scalar loops) can make them differ
+			Sample peak = 0;
+			for (size_t i = 0; i < size; ++i) peak = std::max(peak, std::abs(scalarR[i]) + std::abs(scalarI[i]));
+			const Sample tolerance = peak*std::numeric_limits<Sample>::epsilon()*64;
+			for (size_t i = 0; i < size; ++i) {
+				if (std::abs(vectorR[i] - scalarR[i]) > tolerance || std::abs(vectorI[i] - scalarI[i]) > tolerance) matches = false;
+			}
+		}
+	}
+	level.store(detected);
+	return matches;
+#else
+	return true;
+#endif
+}
+
 }} // namespace
 
 // Platform-specific
@@ -1361,6 +1423,10 @@ using ModifiedRealFFT = RealFFT<Sample, splitComputation, true>;
 #	include "./platform/fft-accelerate.h"
 #elif defined(SIGNALSMITH_USE_IPP)
 #	include "./platform/fft-ipp.h"
+#elif defined(SIGNALSMITH_USE_PFFFT)
+#	include "./platform/fft-pffft.h"
+#elif defined(SIGNALSMITH_USE_STOCKHAM)
+#	include "./platform/fft-stockham.h"
 #endif
 
 #endif // include guard
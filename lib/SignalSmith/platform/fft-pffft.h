@@ -0,0 +1,106 @@
+#ifndef SIGNALSMITH_AUDIO_LINEAR_FFT_PFFFT_H
+#define SIGNALSMITH_AUDIO_LINEAR_FFT_PFFFT_H
+
+// Pow2FFT<float> on PFFFT (https://github.com/marton78/pffft, or the original by Julien Pommier),
+// which isn't vendored: it builds against the checkout PFFFT_ROOT points at.
+// Everything above it - SplitFFT's factors of 3 and 5, the split computation, RealFFT's packing
+// and half-bin shift - stays as it is, so switching backend doesn't change what the STFT sees.
+// Double precision keeps the bundled implementation.
+
+#include "pffft.h"
+
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace signalsmith { namespace linear {
+
+template<>
+struct Pow2FFT<float> {
+	// PFFFT takes interleaved complex natively, so SplitFFT and RealFFT use that path
+	static constexpr bool prefersSplit = false;
+	using Complex = std::complex<float>;
+
+	Pow2FFT(size_t size=0) {
+		resize(size);
+	}
+
+	void resize(size_t size) {
+		_size = size;
+		simpleFFT.resize(size);
+		// Complex transforms need a multiple of the squared SIMD width; smaller ones stay bundled
+		setup.reset(size ? pffft_new_setup(int(size), PFFFT_COMPLEX) : nullptr);
+		for (auto *buffer : {&in, &out, &work}) {
+			buffer->reset(setup ? static_cast<float *>(pffft_aligned_malloc(2*size*sizeof(float))) : nullptr);
+		}
+	}
+
+	void fft(const Complex *time, Complex *freq) {
+		if (!setup) return simpleFFT.fft(time, freq);
+		transform(time, freq, PFFFT_FORWARD);
+	}
+	void fft(const float *inR, const float *inI, float *outR, float *outI) {
+		if (!setup) return simpleFFT.fft(inR, inI, outR, outI);
+		transformSplit(inR, inI, outR, outI, PFFFT_FORWARD);
+	}
+
+	void ifft(const Complex *freq, Complex *time) {
+		if (!setup) return simpleFFT.ifft(freq, time);
+		transform(freq, time, PFFFT_BACKWARD);
+	}
+	void ifft(const float *inR, const float *inI, float *outR, float *outI) {
+		if (!setup) return simpleFFT.ifft(inR, inI, outR, outI);
+		transformSplit(inR, inI, outR, outI, PFFFT_BACKWARD);
+	}
+
+private:
+	struct SetupDeleter {
+		void operator()(PFFFT_Setup *s) const {
+			pffft_destroy_setup(s);
+		}
+	};
+	struct AlignedDeleter {
+		void operator()(float *p) const {
+			pffft_aligned_free(p);
+		}
+	};
+
+	size_t _size = 0;
+	std::unique_ptr<PFFFT_Setup, SetupDeleter> setup;
+	std::unique_ptr<float[], AlignedDeleter> in, out, work;
+	SimpleFFT<float> simpleFFT;
+
+	static bool aligned(const void *p) {
+		return reinterpret_cast<std::uintptr_t>(p)%(pffft_simd_size()*sizeof(float)) == 0;
+	}
+
+	// SplitFFT hands over offsets into its own buffers, so only copy when they're not SIMD-aligned
+	void transform(const Complex *input, Complex *output, pffft_direction_t direction) {
+		auto *inputF = reinterpret_cast<const float *>(input);
+		auto *outputF = reinterpret_cast<float *>(output);
+		if (aligned(inputF) && aligned(outputF)) {
+			pffft_transform_ordered(setup.get(), inputF, outputF, work.get(), direction);
+			return;
+		}
+		std::memcpy(in.get(), inputF, 2*_size*sizeof(float));
+		pffft_transform_ordered(setup.get(), in.get(), out.get(), work.get(), direction);
+		std::memcpy(outputF, out.get(), 2*_size*sizeof(float));
+	}
+
+	void transformSplit(const float *inR, const float *inI, float *outR, float *outI, pffft_direction_t direction) {
+		for (size_t i = 0; i < _size; ++i) {
+			in[2*i] = inR[i];
+			in[2*i + 1] = inI[i];
+		}
+		pffft_transform_ordered(setup.get(), in.get(), out.get(), work.get(), direction);
+		for (size_t i = 0; i < _size; ++i) {
+			outR[i] = out[2*i];
+			outI[i] = out[2*i + 1];
+		}
+	}
+};
+
+}} // namespace
+
+#endif // include guard
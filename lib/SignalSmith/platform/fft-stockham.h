@@ -0,0 +1,105 @@
+#ifndef SIGNALSMITH_AUDIO_LINEAR_FFT_STOCKHAM_H
+#define SIGNALSMITH_AUDIO_LINEAR_FFT_STOCKHAM_H
+
+// Pow2FFT<float> on Deranger's own Stockham FFT in lib/stockham.
+// Everything above it - SplitFFT's factors of 3 and 5, the split computation, RealFFT's packing
+// and half-bin shift - stays as it is, so switching backend doesn't change what the STFT sees.
+// Double precision keeps the bundled implementation.
+
+#include "stockham.h"
+
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace signalsmith { namespace linear {
+
+template<>
+struct Pow2FFT<float> {
+	// The Stockham FFT takes interleaved complex natively, so SplitFFT and RealFFT use that path
+	static constexpr bool prefersSplit = false;
+	using Complex = std::complex<float>;
+
+	Pow2FFT(size_t size=0) {
+		resize(size);
+	}
+
+	void resize(size_t size) {
+		_size = size;
+		simpleFFT.resize(size);
+		// Sizes below 16 stay bundled
+		setup.reset(size ? stockham_new_setup(int(size)) : nullptr);
+		for (auto *buffer : {&in, &out, &work}) {
+			buffer->reset(setup ? static_cast<float *>(stockham_aligned_malloc(2*size*sizeof(float))) : nullptr);
+		}
+	}
+
+	void fft(const Complex *time, Complex *freq) {
+		if (!setup) return simpleFFT.fft(time, freq);
+		transform(time, freq, STOCKHAM_FORWARD);
+	}
+	void fft(const float *inR, const float *inI, float *outR, float *outI) {
+		if (!setup) return simpleFFT.fft(inR, inI, outR, outI);
+		transformSplit(inR, inI, outR, outI, STOCKHAM_FORWARD);
+	}
+
+	void ifft(const Complex *freq, Complex *time) {
+		if (!setup) return simpleFFT.ifft(freq, time);
+		transform(freq, time, STOCKHAM_BACKWARD);
+	}
+	void ifft(const float *inR, const float *inI, float *outR, float *outI) {
+		if (!setup) return simpleFFT.ifft(inR, inI, outR, outI);
+		transformSplit(inR, inI, outR, outI, STOCKHAM_BACKWARD);
+	}
+
+private:
+	struct SetupDeleter {
+		void operator()(Stockham_Setup *s) const {
+			stockham_destroy_setup(s);
+		}
+	};
+	struct AlignedDeleter {
+		void operator()(float *p) const {
+			stockham_aligned_free(p);
+		}
+	};
+
+	size_t _size = 0;
+	std::unique_ptr<Stockham_Setup, SetupDeleter> setup;
+	std::unique_ptr<float[], AlignedDeleter> in, out, work;
+	SimpleFFT<float> simpleFFT;
+
+	static bool aligned(const void *p) {
+		return reinterpret_cast<std::uintptr_t>(p)%(stockham_simd_size()*sizeof(float)) == 0;
+	}
+
+	// SplitFFT hands over offsets into its own buffers, so only copy when they're not SIMD-aligned
+	void transform(const Complex *input, Complex *output, stockham_direction_t direction) {
+		auto *inputF = reinterpret_cast<const float *>(input);
+		auto *outputF = reinterpret_cast<float *>(output);
+		if (aligned(inputF) && aligned(outputF)) {
+			stockham_transform(setup.get(), inputF, outputF, work.get(), direction);
+			return;
+		}
+		std::memcpy(in.get(), inputF, 2*_size*sizeof(float));
+		stockham_transform(setup.get(), in.get(), out.get(), work.get(), direction);
+		std::memcpy(outputF, out.get(), 2*_size*sizeof(float));
+	}
+
+	void transformSplit(const float *inR, const float *inI, float *outR, float *outI, stockham_direction_t direction) {
+		for (size_t i = 0; i < _size; ++i) {
+			in[2*i] = inR[i];
+			in[2*i + 1] = inI[i];
+		}
+		stockham_transform(setup.get(), in.get(), out.get(), work.get(), direction);
+		for (size_t i = 0; i < _size; ++i) {
+			outR[i] = out[2*i];
+			outI[i] = out[2*i + 1];
+		}
+	}
+};
+
+}} // namespace
+
+#endif // include guard
@@ -0,0 +1,83 @@
+// Butterfly and complex-multiply kernels over split-complex arrays, written once against
+// an `Ops<Sample>` vector wrapper. Included by fft-x86.h once per instruction set, inside
+// that set's namespace and target region, so there is deliberately no include guard.
+//
+// Each kernel does the same arithmetic, in the same order, as the scalar loop it replaces
+// in fft.h, so results match the reference exactly when neither uses fused multiply-adds.
+
+// Multiplies by a twiddle, or by its conjugate for the inverse
+template<bool inverse, class S, class V=typename Ops<S>::V>
+void twist(V r, V i, V tr, V ti, V &outR, V &outI) {
+	using O = Ops<S>;
+	if (inverse) {
+		outR = O::add(O::mul(r, tr), O::mul(i, ti));
+		outI = O::sub(O::mul(i, tr), O::mul(r, ti));
+	} else {
+		outR = O::sub(O::mul(r, tr), O::mul(i, ti));
+		outI = O::add(O::mul(i, tr), O::mul(r, ti));
+	}
+}
+
+template<bool inverse, class S>
+void radix4(size_t stride, const S *inR, const S *inI, S *outR, S *outI, size_t quarter, const std::complex<S> &twiddleB, const std::complex<S> &twiddleC, const std::complex<S> &twiddleD) {
+	using O = Ops<S>;
+	const auto tbr = O::set1(twiddleB.real()), tbi = O::set1(twiddleB.imag());
+	const auto tcr = O::set1(twiddleC.real()), tci = O::set1(twiddleC.imag());
+	const auto tdr = O::set1(twiddleD.real()), tdi = O::set1(twiddleD.imag());
+
+	for (size_t s = 0; s < stride; s += O::width) {
+		auto ar = O::load(inR + s), ai = O::load(inI + s);
+		typename O::V br, bi, cr, ci, dr, di;
+		twist<inverse, S>(O::load(inR + stride + s), O::load(inI + stride + s), tbr, tbi, br, bi);
+		twist<inverse, S>(O::load(inR + 2*stride + s), O::load(inI + 2*stride + s), tcr, tci, cr, ci);
+		twist<inverse, S>(O::load(inR + 3*stride + s), O::load(inI + 3*stride + s), tdr, tdi, dr, di);
+
+		auto ac0r = O::add(ar, cr), ac0i = O::add(ai, ci);
+		auto ac1r = O::sub(ar, cr), ac1i = O::sub(ai, ci);
+		auto bd0r = O::add(br, dr), bd0i = O::add(bi, di);
+		auto bd1r = inverse ? O::sub(br, dr) : O::sub(dr, br);
+		auto bd1i = inverse ? O::sub(bi, di) : O::sub(di, bi);
+
+		// bd1 * i = (-bd1i, bd1r)
+		O::store(outR + s, O::add(ac0r, bd0r));
+		O::store(outI + s, O::add(ac0i, bd0i));
+		O::store(outR + quarter + s, O::sub(ac1r, bd1i));
+		O::store(outI + quarter + s, O::add(ac1i, bd1r));
+		O::store(outR + 2*quarter + s, O::sub(ac0r, bd0r));
+		O::store(outI + 2*quarter + s, O::sub(ac0i, bd0i));
+		O::store(outR + 3*quarter + s, O::add(ac1r, bd1i));
+		O::store(outI + 3*quarter + s, O::sub(ac1i, bd1r));
+	}
+}
+
+template<class S>
+void radix2(size_t stride, const S *inR, const S *inI, S *outR, S *outI) {
+	using O = Ops<S>;
+	for (size_t s = 0; s < stride; s += O::width) {
+		auto ar = O::load(inR + s), ai = O::load(inI + s);
+		auto br = O::load(inR + stride + s), bi = O::load(inI + stride + s);
+		O::store(outR + s, O::add(ar, br));
+		O::store(outI + s, O::add(ai, bi));
+		O::store(outR + stride + s, O::sub(ar, br));
+		O::store(outI + stride + s, O::sub(ai, bi));
+	}
+}
+
+// Whole vectors only; returns how many elements were done
+template<bool conj, class S>
+size_t complexMul(S *ar, S *ai, const S *br, const S *bi, const S *cr, const S *ci, size_t size) {
+	using O = Ops<S>;
+	const size_t end = size - size%O::width;
+	for (size_t i = 0; i < end; i += O::width) {
+		auto vbr = O::load(br + i), vbi = O::load(bi + i);
+		auto vcr = O::load(cr + i), vci = O::load(ci + i);
+		if (conj) {
+			O::store(ar + i, O::add(O::mul(vcr, vbr), O::mul(vci, vbi)));
+			O::store(ai + i, O::sub(O::mul(vcr, vbi), O::mul(vci, vbr)));
+		} else {
+			O::store(ar + i, O::sub(O::mul(vbr, vcr), O::mul(vbi, vci)));
+			O::store(ai + i, O::add(O::mul(vbr, vci), O::mul(vbi, vcr)));
+		}
+	}
+	return end;
+}
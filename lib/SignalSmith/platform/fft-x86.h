@@ -0,0 +1,162 @@
+#ifndef SIGNALSMITH_AUDIO_LINEAR_FFT_X86_H
+#define SIGNALSMITH_AUDIO_LINEAR_FFT_X86_H
+
+// SSE2 and AVX2 kernels for the split-complex radix-2/4 passes and complex multiplies in
+// fft.h. SSE2 is always there on x86-64; AVX2 is compiled in regardless of the build's
+// target flags and only used when the CPU (and OS) supports it.
+
+#include <complex>
+#include <cstddef>
+#include <atomic>
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#	include <intrin.h>
+#endif
+
+namespace signalsmith { namespace linear { namespace _impl { namespace simd {
+
+enum class Level {scalar, sse2, avx2};
+
+inline Level detectLevel() {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? Level::avx2 : Level::sse2;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return Level::sse2;
+	__cpuid(info, 1);
+	const bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return osSavesYmm && (info[1] & (1 << 5)) ? Level::avx2 : Level::sse2;
+#else
+	return Level::sse2;
+#endif
+}
+
+/// The kernels in use. Lowering it to `scalar` runs the reference loops, for comparison.
+inline std::atomic<Level> &level() {
+	static std::atomic<Level> current{detectLevel()};
+	return current;
+}
+
+namespace sse2 {
+	template<class S> struct Ops;
+	template<> struct Ops<float> {
+		using V = __m128;
+		static constexpr size_t width = 4;
+		static V load(const float *p) { return _mm_loadu_ps(p); }
+		static void store(float *p, V v) { _mm_storeu_ps(p, v); }
+		static V set1(float x) { return _mm_set1_ps(x); }
+		static V add(V a, V b) { return _mm_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+	};
+	template<> struct Ops<double> {
+		using V = __m128d;
+		static constexpr size_t width = 2;
+		static V load(const double *p) { return _mm_loadu_pd(p); }
+		static void store(double *p, V v) { _mm_storeu_pd(p, v); }
+		static V set1(double x) { return _mm_set1_pd(x); }
+		static V add(V a, V b) { return _mm_add_pd(a, b); }
+		static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+		static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+	};
+#	include "./fft-x86-kernels.h"
+}
+
+#if defined(__clang__)
+#	pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#	pragma GCC push_options
+#	pragma GCC target("avx2")
+#endif
+namespace avx2 {
+	template<class S> struct Ops;
+	template<> struct Ops<float> {
+		using V = __m256;
+		static constexpr size_t width = 8;
+		static V load(const float *p) { return _mm256_loadu_ps(p); }
+		static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+		static V set1(float x) { return _mm256_set1_ps(x); }
+		static V add(V a, V b) { return _mm256_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	};
+	template<> struct Ops<double> {
+		using V = __m256d;
+		static constexpr size_t width = 4;
+		static V load(const double *p) { return _mm256_loadu_pd(p); }
+		static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+		static V set1(double x) { return _mm256_set1_pd(x); }
+		static V add(V a, V b) { return _mm256_add_pd(a, b); }
+		static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+		static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+	};
+#	include "./fft-x86-kernels.h"
+}
+#if defined(__clang__)
+#	pragma clang attribute pop
+#elif defined(__GNUC__)
+#	pragma GCC pop_options
+#endif
+
+// Dispatch: the butterflies take a pass only if its stride is whole vectors, which it is
+// everywhere except the last pass or two (strides are powers of 4). Anything else falls
+// through to the scalar loop, as does any Sample type other than float and double.
+
+template<class S>
+bool radix2(size_t, const S *, const S *, S *, S *) {
+	return false;
+}
+template<class S>
+bool radix4(bool, size_t, const S *, const S *, S *, S *, size_t, const std::complex<S> &, const std::complex<S> &, const std::complex<S> &) {
+	return false;
+}
+template<class S>
+size_t complexMul(bool, S *, S *, const S *, const S *, const S *, const S *, size_t) {
+	return 0;
+}
+
+#define SIGNALSMITH_X86_DISPATCH(Sample) \
+	inline bool radix2(size_t stride, const Sample *inR, const Sample *inI, Sample *outR, Sample *outI) { \
+		const auto current = level().load(std::memory_order_relaxed); \
+		if (current == Level::avx2 && stride%avx2::Ops<Sample>::width == 0) { \
+			avx2::radix2(stride, inR, inI, outR, outI); \
+			return true; \
+		} \
+		if (current != Level::scalar && stride%sse2::Ops<Sample>::width == 0) { \
+			sse2::radix2(stride, inR, inI, outR, outI); \
+			return true; \
+		} \
+		return false; \
+	} \
+	inline bool radix4(bool inverse, size_t stride, const Sample *inR, const Sample *inI, Sample *outR, Sample *outI, size_t quarter, const std::complex<Sample> &b, const std::complex<Sample> &c, const std::complex<Sample> &d) { \
+		const auto current = level().load(std::memory_order_relaxed); \
+		if (current == Level::avx2 && stride%avx2::Ops<Sample>::width == 0) { \
+			if (inverse) avx2::radix4<true>(stride, inR, inI, outR, outI, quarter, b, c, d); \
+			else avx2::radix4<false>(stride, inR, inI, outR, outI, quarter, b, c, d); \
+			return true; \
+		} \
+		if (current != Level::scalar && stride%sse2::Ops<Sample>::width == 0) { \
+			if (inverse) sse2::radix4<true>(stride, inR, inI, outR, outI, quarter, b, c, d); \
+			else sse2::radix4<false>(stride, inR, inI, outR, outI, quarter, b, c, d); \
+			return true; \
+		} \
+		return false; \
+	} \
+	inline size_t complexMul(bool conj, Sample *ar, Sample *ai, const Sample *br, const Sample *bi, const Sample *cr, const Sample *ci, size_t size) { \
+		switch (level().load(std::memory_order_relaxed)) { \
+			case Level::avx2: return conj ? avx2::complexMul<true>(ar, ai, br, bi, cr, ci, size) : avx2::complexMul<false>(ar, ai, br, bi, cr, ci, size); \
+			case Level::sse2: return conj ? sse2::complexMul<true>(ar, ai, br, bi, cr, ci, size) : sse2::complexMul<false>(ar, ai, br, bi, cr, ci, size); \
+			default: return 0; \
+		} \
+	}
+
+SIGNALSMITH_X86_DISPATCH(float)
+SIGNALSMITH_X86_DISPATCH(double)
+#undef SIGNALSMITH_X86_DISPATCH
+
+}}}} // namespace
+
+#endif // include guard
@@ -57,7 +57,10 @@ struct SignalsmithStretch {
 		stashedOutput = stft.output;
 		
 		prevInputOffset = -1;
-		channelBands.assign(channelBands.size(), Band());
+		linkChannels = linkRequested && channels > 1;
+		clearBands();
+		std::fill(bandInput.begin(), bandInput.end(), Complex(0));
+		std::fill(bandInputEnergy.begin(), bandInputEnergy.end(), Sample(0));
 		silenceCounter = 0;
 		didSeek = false;
 		blockProcess = {};
@@ -84,13 +87,29 @@ struct SignalsmithStretch {
 		tmpBuffer.resize(blockSamples + intervalSamples);
 
 		bands = int(stft.bands());
-		channelBands.assign(bands*channels, Band());
+		linkChannels = linkRequested && channels > 1;
+		// One more channel than the input, for the mid when linked
+		for (auto *field : {&bandInput, &bandPrevInput, &bandOutput, &predictionInput}) {
+			field->assign(bands*(channels + 1), Complex(0));
+		}
+		for (auto *field : {&bandInputEnergy, &predictionEnergy}) {
+			field->assign(bands*(channels + 1), Sample(0));
+		}
+		
+		// Each band's phase advance over one interval, for rotating the previous frame into this one
+		bandRotations.resize(bands);
+		Complex rot = std::polar(Sample(1), bandToFreq(0)*stft.defaultInterval()*Sample(2*M_PI));
+		Sample freqStep = bandToFreq(1) - bandToFreq(0);
+		Complex rotStep = std::polar(Sample(1), freqStep*stft.defaultInterval()*Sample(2*M_PI));
+		for (auto &r : bandRotations) {
+			r = rot;
+			rot = _impl::mul(rot, rotStep);
+		}
 		
 		peaks.reserve(bands/2);
 		energy.resize(bands);
 		smoothedEnergy.resize(bands);
 		outputMap.resize(bands);
-		channelPredictions.resize(channels*bands);
 
 		blockProcess = {};
 		formantMetric.resize(bands + 2);
@@ -113,6 +132,15 @@ struct SignalsmithStretch {
 	void setFreqMap(std::function<Sample(Sample)> inputToOutput) {
 		customFreqMap = inputToOutput;
 	}
+	
+	/// Predicts phases once, from the average of all channels, and locks every channel to that.
+	/// Keeps the image steady rather than saving CPU: it skips one channel's phase prediction but
+	/// adds a lookup per channel, so stereo costs within a few percent of unlinked. Content that
+	/// cancels in the mid falls back to each channel's own input phase.
+	/// Takes effect from the next configure() or reset().
+	void setLinkedChannels(bool linked) {
+		linkRequested = linked;
+	}
 
 	void setFormantFactor(Sample multiplier, bool compensatePitch=false) {
 		formantMultiplier = multiplier;
@@ -156,6 +184,13 @@ struct SignalsmithStretch {
 		seekTimeFactor = (playbackRate*stft.defaultInterval() > 1) ? 1/playbackRate : stft.defaultInterval();
 	}
 	
+	/// True if process() would only copy this input through: it's silent, and so was enough of
+	/// what came before it that there's nothing left to flush. Skipping the call is then harmless.
+	template<class Inputs>
+	bool passesThrough(Inputs &&inputs, int inputSamples) const {
+		return !silenceFirst && silenceCounter >= 2*stft.blockSamples() && inputEnergy(inputs, inputSamples) < noiseFloor;
+	}
+
 	template<class Inputs, class Outputs>
 	void process(Inputs &&inputs, int inputSamples, Outputs &&outputs, int outputSamples) {
 #ifdef SIGNALSMITH_STRETCH_PROFILE_PROCESS_START
@@ -178,25 +213,16 @@ struct SignalsmithStretch {
 			prevCopiedInput = toIndex;
 		};
 
-		Sample totalEnergy = 0;
-		for (int c = 0; c < channels; ++c) {
-			auto &&inputChannel = inputs[c];
-			for (int i = 0; i < inputSamples; ++i) {
-				Sample s = inputChannel[i];
-				totalEnergy += s*s;
-			}
-		}
-
+		Sample totalEnergy = inputEnergy(inputs, inputSamples);
 		if (totalEnergy < noiseFloor) {
 			if (silenceCounter >= 2*stft.blockSamples()) {
 				if (silenceFirst) { // first block of silence processing
 					silenceFirst = false;
 					//stft.reset();
 					blockProcess = {};
-					for (auto &b : channelBands) {
-						b.input = b.prevInput = b.output = 0;
-						b.inputEnergy = 0;
-					}
+					clearBands();
+					std::fill(bandInput.begin(), bandInput.end(), Complex(0));
+					std::fill(bandInputEnergy.begin(), bandInputEnergy.end(), Sample(0));
 				}
 			
 				if (inputSamples > 0) {
@@ -292,12 +318,10 @@ struct SignalsmithStretch {
 						if (step < 1) {
 							// Copy previous analysis to our band objects
 							for (int c = 0; c < channels; ++c) {
-								auto channelBands = bandsForChannel(c);
 								auto *spectrumBands = stft.spectrum(c);
-								for (int b = 0; b < bands; ++b) {
-									channelBands[b].prevInput = spectrumBands[b];
-								}
+								std::copy(spectrumBands, spectrumBands + bands, forChannel(bandPrevInput, c));
 							}
+							if (linkChannels) updateMid(bandPrevInput);
 							continue;
 						}
 						step -= 1;
@@ -314,12 +338,10 @@ struct SignalsmithStretch {
 					if (step < 1) {
 						// Copy analysed spectrum into our band objects
 						for (int c = 0; c < channels; ++c) {
-							auto channelBands = bandsForChannel(c);
 							auto *spectrumBands = stft.spectrum(c);
-							for (int b = 0; b < bands; ++b) {
-								channelBands[b].input = spectrumBands[b];
-							}
+							std::copy(spectrumBands, spectrumBands + bands, forChannel(bandInput, c));
 						}
+						if (linkChannels) updateMid(bandInput);
 						continue;
 					}
 					step -= 1;
@@ -334,11 +356,8 @@ struct SignalsmithStretch {
 				if (step < 1) {
 					// Copy band objects into spectrum
 					for (int c = 0; c < channels; ++c) {
-						auto channelBands = bandsForChannel(c);
-						auto *spectrumBands = stft.spectrum(c);
-						for (int b = 0; b < bands; ++b) {
-							spectrumBands[b] = channelBands[b].output;
-						}
+						auto *output = forChannel(bandOutput, c);
+						std::copy(output, output + bands, stft.spectrum(c));
 					}
 					continue;
 				}
@@ -395,15 +414,11 @@ struct SignalsmithStretch {
 		stft.reset(0.1);
 
 		// Reset the phase-vocoder stuff, so the next block gets a fresh start
-		for (int c = 0; c < channels; ++c) {
-			auto channelBands = bandsForChannel(c);
-			for (int b = 0; b < bands; ++b) {
-				channelBands[b].prevInput = channelBands[b].output = 0;
-			}
-		}
+		clearBands();
 	}
 private:
 	bool _splitComputation = false;
+	bool linkRequested = false, linkChannels = false;
 	struct {
 		size_t samplesSinceLast = std::numeric_limits<size_t>::max();
 		size_t steps = 0;
@@ -421,6 +436,18 @@ private:
 	static constexpr Sample maxCleanStretch{2}; // time-stretch ratio before we start randomising phases
 	size_t silenceCounter = 0;
 	bool silenceFirst = true;
+	template<class Inputs>
+	Sample inputEnergy(Inputs &&inputs, int inputSamples) const {
+		Sample totalEnergy = 0;
+		for (int c = 0; c < channels; ++c) {
+			auto &&inputChannel = inputs[c];
+			for (int i = 0; i < inputSamples; ++i) {
+				Sample s = inputChannel[i];
+				totalEnergy += s*s;
+			}
+		}
+		return totalEnergy;
+	}
 
 	Sample freqMultiplier = 1, freqTonalityLimit = 0.5;
 	std::function<Sample(Sample)> customFreqMap = nullptr;
@@ -447,48 +474,56 @@ private:
 		return stft.freqToBin(f);
 	}
 	
-	struct Band {
-		Complex input, prevInput{0};
-		Complex output{0};
-		Sample inputEnergy;
-	};
-	std::vector<Band> channelBands;
-	Band * bandsForChannel(int channel) {
-		return channelBands.data() + channel*bands;
+	// Per-band state, one array per field, each laid out [channel*bands + band] so the
+	// whole-spectrum loops walk plain contiguous arrays
+	std::vector<Complex> bandInput, bandPrevInput, bandOutput;
+	std::vector<Sample> bandInputEnergy;
+	std::vector<Complex> bandRotations; // one interval's phase advance, shared by all channels
+	template<typename V>
+	V * forChannel(std::vector<V> &field, int channel) {
+		return field.data() + channel*bands;
 	}
-	template<Complex Band::*member>
-	Complex getBand(int channel, int index) {
-		if (index < 0 || index >= bands) return 0;
-		return channelBands[index + channel*bands].*member;
+	// When linked, the mid sits after the real channels and makes the phase predictions for all of them
+	int predictionChannels() const {
+		return linkChannels ? 1 : channels;
 	}
-	template<Complex Band::*member>
-	Complex getFractional(int channel, int lowIndex, Sample fractional) {
-		Complex low = getBand<member>(channel, lowIndex);
-		Complex high = getBand<member>(channel, lowIndex + 1);
-		return low + (high - low)*fractional;
+	int predictionChannel(int index) const {
+		return linkChannels ? channels : index;
 	}
-	template<Complex Band::*member>
-	Complex getFractional(int channel, Sample inputIndex) {
-		int lowIndex = std::floor(inputIndex);
-		Sample fracIndex = inputIndex - lowIndex;
-		return getFractional<member>(channel, lowIndex, fracIndex);
+	void updateMid(std::vector<Complex> &field) {
+		Complex *mid = forChannel(field, channels);
+		std::fill(mid, mid + bands, Complex(0));
+		for (int c = 0; c < channels; ++c) {
+			const Complex *channel = forChannel(field, c);
+			for (int b = 0; b < bands; ++b) {
+				mid[b] += channel[b];
+			}
+		}
+		Sample scale = Sample(1)/channels;
+		for (int b = 0; b < bands; ++b) {
+			mid[b] *= scale;
+		}
+	}
+	void clearBands() {
+		std::fill(bandPrevInput.begin(), bandPrevInput.end(), Complex(0));
+		std::fill(bandOutput.begin(), bandOutput.end(), Complex(0));
 	}
-	template<Sample Band::*member>
-	Sample getBand(int channel, int index) {
+	template<typename V>
+	V getBand(const std::vector<V> &field, int channel, int index) const {
 		if (index < 0 || index >= bands) return 0;
-		return channelBands[index + channel*bands].*member;
+		return field[index + channel*bands];
 	}
-	template<Sample Band::*member>
-	Sample getFractional(int channel, int lowIndex, Sample fractional) {
-		Sample low = getBand<member>(channel, lowIndex);
-		Sample high = getBand<member>(channel, lowIndex + 1);
+	template<typename V>
+	V getFractional(const std::vector<V> &field, int channel, int lowIndex, Sample fractional) const {
+		V low = getBand(field, channel, lowIndex);
+		V high = getBand(field, channel, lowIndex + 1);
 		return low + (high - low)*fractional;
 	}
-	template<Sample Band::*member>
-	Sample getFractional(int channel, Sample inputIndex) {
+	template<typename V>
+	V getFractional(const std::vector<V> &field, int channel, Sample inputIndex) const {
 		int lowIndex = std::floor(inputIndex);
 		Sample fracIndex = inputIndex - lowIndex;
-		return getFractional<member>(channel, lowIndex, fracIndex);
+		return getFractional(field, channel, lowIndex, fracIndex);
 	}
 
 	struct Peak {
@@ -501,22 +536,16 @@ private:
 	};
 	std::vector<PitchMapPoint> outputMap;
 	
-	struct Prediction {
-		Sample energy = 0;
-		Complex input;
-
-		Complex makeOutput(Complex phase) {
-			Sample phaseNorm = _impl::norm(phase);
-			if (phaseNorm <= noiseFloor) {
-				phase = input; // prediction is too weak, fall back to the input
-				phaseNorm = _impl::norm(input) + noiseFloor;
-			}
-			return phase*std::sqrt(energy/phaseNorm);
+	// Phase-vocoder predictions, same layout as the band state
+	std::vector<Sample> predictionEnergy;
+	std::vector<Complex> predictionInput;
+	static Complex makeOutput(Complex phase, Sample energy, Complex input) {
+		Sample phaseNorm = _impl::norm(phase);
+		if (phaseNorm <= noiseFloor) {
+			phase = input; // prediction is too weak, fall back to the input
+			phaseNorm = _impl::norm(input) + noiseFloor;
 		}
-	};
-	std::vector<Prediction> channelPredictions;
-	Prediction * predictionsForChannel(int c) {
-		return channelPredictions.data() + c*bands;
+		return phase*std::sqrt(energy/phaseNorm);
 	}
 
 	// If RandomEngine=void, use std::default_random_engine;
@@ -531,13 +560,13 @@ private:
 	static constexpr size_t splitMainPrediction = 8; // it's just heavy, since we're blending up to 4 different phase predictions
 	void updateProcessSpectrumSteps() {
 		processSpectrumSteps = 0;
-		if (blockProcess.newSpectrum) processSpectrumSteps += channels;
+		if (blockProcess.newSpectrum) processSpectrumSteps += predictionChannels();
 		if (blockProcess.mappedFrequencies) {
 			processSpectrumSteps += smoothEnergySteps;
 			processSpectrumSteps += 1; // findPeaks
 		}
 		processSpectrumSteps += 1; // updating the output map
-		processSpectrumSteps += channels; // preliminary phase-vocoder prediction
+		processSpectrumSteps += predictionChannels(); // preliminary phase-vocoder prediction
 		processSpectrumSteps += splitMainPrediction;
 		if (blockProcess.newSpectrum) processSpectrumSteps += 1; // .input -> .prevInput
 		if (blockProcess.processFormants) processSpectrumSteps += 3;
@@ -552,23 +581,18 @@ private:
 		std::uniform_real_distribution<Sample> timeFactorDist(maxCleanStretch*2*randomTimeFactor - timeFactor, timeFactor);
 
 		if (blockProcess.newSpectrum) {
-			if (step < size_t(channels)) {
-				int channel = int(step);
-				auto bins = bandsForChannel(channel);
-
-				Complex rot = std::polar(Sample(1), bandToFreq(0)*stft.defaultInterval()*Sample(2*M_PI));
-				Sample freqStep = bandToFreq(1) - bandToFreq(0);
-				Complex rotStep = std::polar(Sample(1), freqStep*stft.defaultInterval()*Sample(2*M_PI));
-				 
+			if (step < size_t(predictionChannels())) {
+				int channel = predictionChannel(int(step));
+				Complex *output = forChannel(bandOutput, channel);
+				Complex *prevInput = forChannel(bandPrevInput, channel);
+				const Complex *rotations = bandRotations.data();
 				for (int b = 0; b < bands; ++b) {
-					auto &bin = bins[b];
-					bin.output = _impl::mul(bin.output, rot);
-					bin.prevInput = _impl::mul(bin.prevInput, rot);
-					rot = _impl::mul(rot, rotStep);
+					output[b] = _impl::mul(output[b], rotations[b]);
+					prevInput[b] = _impl::mul(prevInput[b], rotations[b]);
 				}
 				return;
 			}
-			step -= channels;
+			step -= predictionChannels();
 		}
 		if (blockProcess.mappedFrequencies) {
 			if (step < smoothEnergySteps) {
@@ -585,11 +609,8 @@ private:
 			if (blockProcess.mappedFrequencies) {
 				updateOutputMap();
 			} else { // we're not pitch-shifting, so no need to find peaks etc.
-				for (int c = 0; c < channels; ++c) {
-					Band *bins = bandsForChannel(c);
-					for (int b = 0; b < bands; ++b) {
-						bins[b].inputEnergy = _impl::norm(bins[b].input);
-					}
+				for (int i = 0; i < bands*(channels + linkChannels); ++i) {
+					bandInputEnergy[i] = _impl::norm(bandInput[i]);
 				}
 
 				for (int b = 0; b < bands; ++b) {
@@ -606,30 +627,38 @@ private:
 			step -= 3;
 		}
 		// Preliminary output prediction from phase-vocoder
-		if (step < size_t(channels)) {
-			int c = int(step);
-			Band *bins = bandsForChannel(c);
-			auto *predictions = predictionsForChannel(c);
+		if (step < size_t(predictionChannels())) {
+			int c = predictionChannel(int(step));
+			Complex *output = forChannel(bandOutput, c);
+			Sample *energies = forChannel(predictionEnergy, c);
+			Complex *inputs = forChannel(predictionInput, c);
 			for (int b = 0; b < bands; ++b) {
 				auto mapPoint = outputMap[b];
 				int lowIndex = std::floor(mapPoint.inputBin);
 				Sample fracIndex = mapPoint.inputBin - lowIndex;
 
-				Prediction &prediction = predictions[b];
-				Sample prevEnergy = prediction.energy;
-				prediction.energy = getFractional<&Band::inputEnergy>(c, lowIndex, fracIndex);
-				prediction.energy *= std::max<Sample>(0, mapPoint.freqGrad); // scale the energy according to local stretch factor
-				prediction.input = getFractional<&Band::input>(c, lowIndex, fracIndex);
-
-				auto &outputBin = bins[b];
-				Complex prevInput = getFractional<&Band::prevInput>(c, lowIndex, fracIndex);
-				Complex freqTwist = _impl::mul<true>(prediction.input, prevInput);
-				Complex phase = _impl::mul(outputBin.output, freqTwist);
-				outputBin.output = phase/(std::max(prevEnergy, prediction.energy) + noiseFloor);
+				Sample prevEnergy = energies[b];
+				Sample energy = getFractional(bandInputEnergy, c, lowIndex, fracIndex);
+				energy *= std::max<Sample>(0, mapPoint.freqGrad); // scale the energy according to local stretch factor
+				Complex input = getFractional(bandInput, c, lowIndex, fracIndex);
+				energies[b] = energy;
+				inputs[b] = input;
+
+				Complex prevInput = getFractional(bandPrevInput, c, lowIndex, fracIndex);
+				Complex freqTwist = _impl::mul<true>(input, prevInput);
+				Complex phase = _impl::mul(output[b], freqTwist);
+				output[b] = phase/(std::max(prevEnergy, energy) + noiseFloor);
+
+				// Linked channels only need their own level and input, to lock to the mid with
+				for (int lc = 0; linkChannels && lc < channels; ++lc) {
+					int index = b + lc*bands;
+					predictionEnergy[index] = getFractional(bandInputEnergy, lc, lowIndex, fracIndex)*std::max<Sample>(0, mapPoint.freqGrad);
+					predictionInput[index] = getFractional(bandInput, lc, lowIndex, fracIndex);
+				}
 			}
 			return;
 		}
-		step -= channels;
+		step -= predictionChannels();
 
 		if (step < splitMainPrediction) {
 			// Re-predict using phase differences between frequencies
@@ -637,21 +666,19 @@ private:
 			int startB = int(bands*chunk/splitMainPrediction);
 			int endB = int(bands*(chunk + 1)/splitMainPrediction);
 			for (int b = startB; b < endB; ++b) {
-				// Find maximum-energy channel and calculate that
-				int maxChannel = 0;
-				Sample maxEnergy = predictionsForChannel(0)[b].energy;
-				for (int c = 1; c < channels; ++c) {
-					Sample e = predictionsForChannel(c)[b].energy;
+				// Find maximum-energy channel (or take the mid, when linked) and calculate that
+				int maxChannel = linkChannels ? channels : 0;
+				Sample maxEnergy = predictionEnergy[b + maxChannel*bands];
+				for (int c = 1; c < channels && !linkChannels; ++c) {
+					Sample e = predictionEnergy[b + c*bands];
 					if (e > maxEnergy) {
 						maxChannel = c;
 						maxEnergy = e;
 					}
 				}
 
-				auto *predictions = predictionsForChannel(maxChannel);
-				auto &prediction = predictions[b];
-				auto *bins = bandsForChannel(maxChannel);
-				auto &outputBin = bins[b];
+				const Complex *inputs = forChannel(predictionInput, maxChannel);
+				Complex *output = forChannel(bandOutput, maxChannel);
 
 				Complex phase = 0;
 				auto mapPoint = outputMap[b];
@@ -659,55 +686,47 @@ private:
 				// Upwards vertical steps
 				if (b > 0) {
 					Sample binTimeFactor = randomTimeFactor ? timeFactorDist(randomEngine) : timeFactor;
-					Complex downInput = getFractional<&Band::input>(maxChannel, mapPoint.inputBin - binTimeFactor);
-					Complex shortVerticalTwist = _impl::mul<true>(prediction.input, downInput);
+					Complex downInput = getFractional(bandInput, maxChannel, mapPoint.inputBin - binTimeFactor);
+					Complex shortVerticalTwist = _impl::mul<true>(inputs[b], downInput);
 
-					auto &downBin = bins[b - 1];
-					phase += _impl::mul(downBin.output, shortVerticalTwist);
+					phase += _impl::mul(output[b - 1], shortVerticalTwist);
 					
 					if (b >= longVerticalStep) {
-						Complex longDownInput = getFractional<&Band::input>(maxChannel, mapPoint.inputBin - longVerticalStep*binTimeFactor);
-						Complex longVerticalTwist = _impl::mul<true>(prediction.input, longDownInput);
+						Complex longDownInput = getFractional(bandInput, maxChannel, mapPoint.inputBin - longVerticalStep*binTimeFactor);
+						Complex longVerticalTwist = _impl::mul<true>(inputs[b], longDownInput);
 
-						auto &longDownBin = bins[b - longVerticalStep];
-						phase += _impl::mul(longDownBin.output, longVerticalTwist);
+						phase += _impl::mul(output[b - longVerticalStep], longVerticalTwist);
 					}
 				}
 				// Downwards vertical steps
 				if (b < bands - 1) {
-					auto &upPrediction = predictions[b + 1];
 					auto &upMapPoint = outputMap[b + 1];
 
 					Sample binTimeFactor = randomTimeFactor ? timeFactorDist(randomEngine) : timeFactor;
-					Complex downInput = getFractional<&Band::input>(maxChannel, upMapPoint.inputBin - binTimeFactor);
-					Complex shortVerticalTwist = _impl::mul<true>(upPrediction.input, downInput);
+					Complex downInput = getFractional(bandInput, maxChannel, upMapPoint.inputBin - binTimeFactor);
+					Complex shortVerticalTwist = _impl::mul<true>(inputs[b + 1], downInput);
 
-					auto &upBin = bins[b + 1];
-					phase += _impl::mul<true>(upBin.output, shortVerticalTwist);
+					phase += _impl::mul<true>(output[b + 1], shortVerticalTwist);
 					
 					if (b < bands - longVerticalStep) {
-						auto &longUpPrediction = predictions[b + longVerticalStep];
 						auto &longUpMapPoint = outputMap[b + longVerticalStep];
 
-						Complex longDownInput = getFractional<&Band::input>(maxChannel, longUpMapPoint.inputBin - longVerticalStep*binTimeFactor);
-						Complex longVerticalTwist = _impl::mul<true>(longUpPrediction.input, longDownInput);
+						Complex longDownInput = getFractional(bandInput, maxChannel, longUpMapPoint.inputBin - longVerticalStep*binTimeFactor);
+						Complex longVerticalTwist = _impl::mul<true>(inputs[b + longVerticalStep], longDownInput);
 
-						auto &longUpBin = bins[b + longVerticalStep];
-						phase += _impl::mul<true>(longUpBin.output, longVerticalTwist);
+						phase += _impl::mul<true>(output[b + longVerticalStep], longVerticalTwist);
 					}
 				}
 
-				outputBin.output = prediction.makeOutput(phase);
+				output[b] = makeOutput(phase, maxEnergy, inputs[b]);
 				
 				// All other bins are locked in phase
 				for (int c = 0; c < channels; ++c) {
 					if (c != maxChannel) {
-						auto &channelBin = bandsForChannel(c)[b];
-						auto &channelPrediction = predictionsForChannel(c)[b];
-						
-						Complex channelTwist = _impl::mul<true>(channelPrediction.input, prediction.input);
-						Complex channelPhase = _impl::mul(outputBin.output, channelTwist);
-						channelBin.output = channelPrediction.makeOutput(channelPhase);
+						int index = b + c*bands;
+						Complex channelTwist = _impl::mul<true>(predictionInput[index], inputs[b]);
+						Complex channelPhase = _impl::mul(output[b], channelTwist);
+						bandOutput[index] = makeOutput(channelPhase, predictionEnergy[index], predictionInput[index]);
 					}
 				}
 			}
@@ -717,9 +736,7 @@ private:
 
 		if (blockProcess.newSpectrum) {
 			if (step-- == 0) {
-				for (auto &bin : channelBands) {
-					bin.prevInput = bin.input;
-				}
+				std::copy(bandInput.begin(), bandInput.end(), bandPrevInput.begin());
 			}
 		}
 	}
@@ -732,13 +749,21 @@ private:
 		if (step-- == 0) {
 			for (auto &e : energy) e = 0;
 			for (int c = 0; c < channels; ++c) {
-				Band *bins = bandsForChannel(c);
+				const Complex *input = forChannel(bandInput, c);
+				Sample *inputEnergy = forChannel(bandInputEnergy, c);
 				for (int b = 0; b < bands; ++b) {
-					Sample e = _impl::norm(bins[b].input);
-					bins[b].inputEnergy = e; // Used for interpolating prediction energy
+					Sample e = _impl::norm(input[b]);
+					inputEnergy[b] = e; // Used for interpolating prediction energy
 					energy[b] += e;
 				}
 			}
+			if (linkChannels) {
+				const Complex *input = forChannel(bandInput, channels);
+				Sample *inputEnergy = forChannel(bandInputEnergy, channels);
+				for (int b = 0; b < bands; ++b) {
+					inputEnergy[b] = _impl::norm(input[b]);
+				}
+			}
 			for (int b = 0; b < bands; ++b) {
 				smoothedEnergy[b] = energy[b];
 			}
@@ -885,9 +910,9 @@ private:
 		if (step-- == 0) {
 			for (auto &e : formantMetric) e = 0;
 			for (int c = 0; c < channels; ++c) {
-				Band *bins = bandsForChannel(c);
+				const Sample *inputEnergy = forChannel(bandInputEnergy, c);
 				for (int b = 0; b < bands; ++b) {
-					formantMetric[b] += bins[b].inputEnergy;
+					formantMetric[b] += inputEnergy[b];
 				}
 			}
 
@@ -931,10 +956,9 @@ private:
 				Sample formantRatio = targetE/(inputE + Sample(1e-30));
 				Sample energyRatio = formantRatio*formantRatio;
 
-				for (int c = 0; c < channels; ++c) {
-					Band *bins = bandsForChannel(c);
+				for (int c = 0; c < channels + linkChannels; ++c) {
 					// This is what's used to decide the output energy, so this affects the output
-					bins[b].inputEnergy *= energyRatio;
+					bandInputEnergy[b + c*bands] *= energyRatio;
 				}
 			}
 		}
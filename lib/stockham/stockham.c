@@ -0,0 +1,317 @@
+/* Stockham autosort FFT: radix-4 passes, then one radix-2 pass when N is 2 * 4^k.
+   Interleaved complex values are split into real and imaginary arrays by the first pass
+   and merged back by the last, so every pass in between works on whole vectors of four.
+   The backward transform swaps real and imaginary parts on the way in and out. */
+
+#include "stockham.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(STOCKHAM_SIMD_DISABLE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+
+#include <xmmintrin.h>
+#define SIMD_SZ 4
+typedef __m128 v4sf;
+
+static inline v4sf vload(const float *p) { return _mm_load_ps(p); }
+static inline void vstore(float *p, v4sf v) { _mm_store_ps(p, v); }
+static inline v4sf vset1(float f) { return _mm_set1_ps(f); }
+static inline v4sf vadd(v4sf a, v4sf b) { return _mm_add_ps(a, b); }
+static inline v4sf vsub(v4sf a, v4sf b) { return _mm_sub_ps(a, b); }
+static inline v4sf vmul(v4sf a, v4sf b) { return _mm_mul_ps(a, b); }
+
+/* (a0 b0 a1 b1), (a2 b2 a3 b3) */
+static inline void vinterleave(v4sf a, v4sf b, v4sf *lo, v4sf *hi) {
+	*lo = _mm_unpacklo_ps(a, b);
+	*hi = _mm_unpackhi_ps(a, b);
+}
+/* Inverse of vinterleave */
+static inline void vuninterleave(v4sf lo, v4sf hi, v4sf *a, v4sf *b) {
+	*a = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+	*b = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+static inline void vtranspose4(v4sf *x0, v4sf *x1, v4sf *x2, v4sf *x3) {
+	_MM_TRANSPOSE4_PS(*x0, *x1, *x2, *x3);
+}
+
+#elif !defined(STOCKHAM_SIMD_DISABLE) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+
+#include <arm_neon.h>
+#define SIMD_SZ 4
+typedef float32x4_t v4sf;
+
+static inline v4sf vload(const float *p) { return vld1q_f32(p); }
+static inline void vstore(float *p, v4sf v) { vst1q_f32(p, v); }
+static inline v4sf vset1(float f) { return vdupq_n_f32(f); }
+static inline v4sf vadd(v4sf a, v4sf b) { return vaddq_f32(a, b); }
+static inline v4sf vsub(v4sf a, v4sf b) { return vsubq_f32(a, b); }
+static inline v4sf vmul(v4sf a, v4sf b) { return vmulq_f32(a, b); }
+
+static inline void vinterleave(v4sf a, v4sf b, v4sf *lo, v4sf *hi) {
+	float32x4x2_t z = vzipq_f32(a, b);
+	*lo = z.val[0];
+	*hi = z.val[1];
+}
+static inline void vuninterleave(v4sf lo, v4sf hi, v4sf *a, v4sf *b) {
+	float32x4x2_t u = vuzpq_f32(lo, hi);
+	*a = u.val[0];
+	*b = u.val[1];
+}
+static inline void vtranspose4(v4sf *x0, v4sf *x1, v4sf *x2, v4sf *x3) {
+	float32x4x2_t t0 = vzipq_f32(*x0, *x2), t1 = vzipq_f32(*x1, *x3);
+	float32x4x2_t u0 = vzipq_f32(t0.val[0], t1.val[0]), u1 = vzipq_f32(t0.val[1], t1.val[1]);
+	*x0 = u0.val[0];
+	*x1 = u0.val[1];
+	*x2 = u1.val[0];
+	*x3 = u1.val[1];
+}
+
+#else
+
+/* Plain C: the same four-wide passes, one lane at a time */
+#define SIMD_SZ 1
+typedef struct { float f[4]; } v4sf;
+
+static inline v4sf vload(const float *p) { v4sf v; for (int i = 0; i < 4; ++i) v.f[i] = p[i]; return v; }
+static inline void vstore(float *p, v4sf v) { for (int i = 0; i < 4; ++i) p[i] = v.f[i]; }
+static inline v4sf vset1(float f) { v4sf v; for (int i = 0; i < 4; ++i) v.f[i] = f; return v; }
+static inline v4sf vadd(v4sf a, v4sf b) { for (int i = 0; i < 4; ++i) a.f[i] += b.f[i]; return a; }
+static inline v4sf vsub(v4sf a, v4sf b) { for (int i = 0; i < 4; ++i) a.f[i] -= b.f[i]; return a; }
+static inline v4sf vmul(v4sf a, v4sf b) { for (int i = 0; i < 4; ++i) a.f[i] *= b.f[i]; return a; }
+
+static inline void vinterleave(v4sf a, v4sf b, v4sf *lo, v4sf *hi) {
+	for (int i = 0; i < 2; ++i) {
+		lo->f[2*i] = a.f[i];
+		lo->f[2*i + 1] = b.f[i];
+		hi->f[2*i] = a.f[i + 2];
+		hi->f[2*i + 1] = b.f[i + 2];
+	}
+}
+static inline void vuninterleave(v4sf lo, v4sf hi, v4sf *a, v4sf *b) {
+	for (int i = 0; i < 2; ++i) {
+		a->f[i] = lo.f[2*i];
+		b->f[i] = lo.f[2*i + 1];
+		a->f[i + 2] = hi.f[2*i];
+		b->f[i + 2] = hi.f[2*i + 1];
+	}
+}
+static inline void vtranspose4(v4sf *x0, v4sf *x1, v4sf *x2, v4sf *x3) {
+	v4sf *rows[4] = {x0, x1, x2, x3};
+	for (int r = 0; r < 4; ++r) {
+		for (int c = r + 1; c < 4; ++c) {
+			float t = rows[r]->f[c];
+			rows[r]->f[c] = rows[c]->f[r];
+			rows[c]->f[r] = t;
+		}
+	}
+}
+
+#endif
+
+#define ALIGNMENT 64
+
+struct Stockham_Setup {
+	int N;
+	int radix4Passes; /* including the first, and the last when there's no radix-2 pass */
+	float *twiddles;
+};
+
+/* The radix-4 butterfly, with y1 to y3 still to be rotated: for inputs a, b, c, d,
+   y0 = a + b + c + d, y1 = (a - c) - j(b - d), y2 = a - b + c - d, y3 = (a - c) + j(b - d) */
+/* Arguments are evaluated more than once, so pass plain variables */
+#define BUTTERFLY4(ar, ai, br, bi, cr, ci, dr, di) \
+	v4sf apcR = vadd(ar, cr), apcI = vadd(ai, ci), amcR = vsub(ar, cr), amcI = vsub(ai, ci); \
+	v4sf bpdR = vadd(br, dr), bpdI = vadd(bi, di), bmdR = vsub(br, dr), bmdI = vsub(bi, di); \
+	v4sf y0R = vadd(apcR, bpdR), y0I = vadd(apcI, bpdI); \
+	v4sf y1R = vadd(amcR, bmdI), y1I = vsub(amcI, bmdR); \
+	v4sf y2R = vsub(apcR, bpdR), y2I = vsub(apcI, bpdI); \
+	v4sf y3R = vsub(amcR, bmdI), y3I = vadd(amcI, bmdR)
+
+static inline void rotate(v4sf *re, v4sf *im, v4sf wr, v4sf wi) {
+	v4sf r = vsub(vmul(*re, wr), vmul(*im, wi));
+	*im = vadd(vmul(*re, wi), vmul(*im, wr));
+	*re = r;
+}
+
+/* n = N, stride 1: reads interleaved input and writes split output. Consecutive butterflies
+   fill the lanes, so each lane has its own twiddles, and the four outputs of each butterfly
+   are adjacent and get transposed into place. */
+static void firstPass(int N, const float *input, float *yr, float *yi, const float *twiddles, int backward) {
+	const int m = N/4;
+	for (int p = 0; p < m; p += 4, twiddles += 24) {
+		v4sf ar, ai, br, bi, cr, ci, dr, di;
+		vuninterleave(vload(input + 2*p), vload(input + 2*p + 4), &ar, &ai);
+		vuninterleave(vload(input + 2*(p + m)), vload(input + 2*(p + m) + 4), &br, &bi);
+		vuninterleave(vload(input + 2*(p + 2*m)), vload(input + 2*(p + 2*m) + 4), &cr, &ci);
+		vuninterleave(vload(input + 2*(p + 3*m)), vload(input + 2*(p + 3*m) + 4), &dr, &di);
+		if (backward) {
+			v4sf t;
+			t = ar; ar = ai; ai = t;
+			t = br; br = bi; bi = t;
+			t = cr; cr = ci; ci = t;
+			t = dr; dr = di; di = t;
+		}
+		BUTTERFLY4(ar, ai, br, bi, cr, ci, dr, di);
+		rotate(&y1R, &y1I, vload(twiddles), vload(twiddles + 4));
+		rotate(&y2R, &y2I, vload(twiddles + 8), vload(twiddles + 12));
+		rotate(&y3R, &y3I, vload(twiddles + 16), vload(twiddles + 20));
+		vtranspose4(&y0R, &y1R, &y2R, &y3R);
+		vtranspose4(&y0I, &y1I, &y2I, &y3I);
+		vstore(yr + 4*p, y0R); vstore(yr + 4*p + 4, y1R); vstore(yr + 4*p + 8, y2R); vstore(yr + 4*p + 12, y3R);
+		vstore(yi + 4*p, y0I); vstore(yi + 4*p + 4, y1I); vstore(yi + 4*p + 8, y2I); vstore(yi + 4*p + 12, y3I);
+	}
+}
+
+/* Length n at stride s (a multiple of 4), split to split. Lanes run along the stride,
+   so every butterfly in a vector shares its twiddles. */
+static void middlePass(int n, int s, const float *xr, const float *xi, float *yr, float *yi, const float *twiddles) {
+	const int m = n/4;
+	for (int p = 0; p < m; ++p, twiddles += 6) {
+		const int a = s*p, b = s*(p + m), c = s*(p + 2*m), d = s*(p + 3*m);
+		const int y = 4*s*p;
+		const v4sf w1r = vset1(twiddles[0]), w1i = vset1(twiddles[1]);
+		const v4sf w2r = vset1(twiddles[2]), w2i = vset1(twiddles[3]);
+		const v4sf w3r = vset1(twiddles[4]), w3i = vset1(twiddles[5]);
+		for (int q = 0; q < s; q += 4) {
+			v4sf ar = vload(xr + a + q), ai = vload(xi + a + q), br = vload(xr + b + q), bi = vload(xi + b + q);
+			v4sf cr = vload(xr + c + q), ci = vload(xi + c + q), dr = vload(xr + d + q), di = vload(xi + d + q);
+			BUTTERFLY4(ar, ai, br, bi, cr, ci, dr, di);
+			if (p != 0) {
+				rotate(&y1R, &y1I, w1r, w1i);
+				rotate(&y2R, &y2I, w2r, w2i);
+				rotate(&y3R, &y3I, w3r, w3i);
+			}
+			vstore(yr + y + q, y0R); vstore(yi + y + q, y0I);
+			vstore(yr + y + s + q, y1R); vstore(yi + y + s + q, y1I);
+			vstore(yr + y + 2*s + q, y2R); vstore(yi + y + 2*s + q, y2I);
+			vstore(yr + y + 3*s + q, y3R); vstore(yi + y + 3*s + q, y3I);
+		}
+	}
+}
+
+static inline void storeInterleaved(float *output, v4sf re, v4sf im, int backward) {
+	v4sf lo, hi;
+	if (backward) vinterleave(im, re, &lo, &hi);
+	else vinterleave(re, im, &lo, &hi);
+	vstore(output, lo);
+	vstore(output + 4, hi);
+}
+
+/* n = 4 at stride N/4, with no twiddles, writing interleaved output */
+static void lastPass4(int N, const float *xr, const float *xi, float *output, int backward) {
+	const int s = N/4;
+	for (int q = 0; q < s; q += 4) {
+		v4sf ar = vload(xr + q), ai = vload(xi + q), br = vload(xr + s + q), bi = vload(xi + s + q);
+		v4sf cr = vload(xr + 2*s + q), ci = vload(xi + 2*s + q), dr = vload(xr + 3*s + q), di = vload(xi + 3*s + q);
+		BUTTERFLY4(ar, ai, br, bi, cr, ci, dr, di);
+		storeInterleaved(output + 2*q, y0R, y0I, backward);
+		storeInterleaved(output + 2*(q + s), y1R, y1I, backward);
+		storeInterleaved(output + 2*(q + 2*s), y2R, y2I, backward);
+		storeInterleaved(output + 2*(q + 3*s), y3R, y3I, backward);
+	}
+}
+
+/* n = 2 at stride N/2, writing interleaved output */
+static void lastPass2(int N, const float *xr, const float *xi, float *output, int backward) {
+	const int s = N/2;
+	for (int q = 0; q < s; q += 4) {
+		v4sf ar = vload(xr + q), ai = vload(xi + q), br = vload(xr + s + q), bi = vload(xi + s + q);
+		storeInterleaved(output + 2*q, vadd(ar, br), vadd(ai, bi), backward);
+		storeInterleaved(output + 2*(q + s), vsub(ar, br), vsub(ai, bi), backward);
+	}
+}
+
+static void computeTwiddles(int n, int p, float *w) {
+	for (int k = 1; k <= 3; ++k) {
+		double phase = -6.283185307179586*(double)(k*p)/n;
+		w[2*(k - 1)] = (float)cos(phase);
+		w[2*(k - 1) + 1] = (float)sin(phase);
+	}
+}
+
+Stockham_Setup *stockham_new_setup(int N) {
+	if (N < 16 || (N & (N - 1))) return NULL;
+
+	Stockham_Setup *setup = (Stockham_Setup *)malloc(sizeof(Stockham_Setup));
+	if (!setup) return NULL;
+	setup->N = N;
+	setup->radix4Passes = 0;
+	for (int n = N; n >= 4; n /= 4) ++setup->radix4Passes;
+
+	/* First pass: per group of four butterflies, w1 to w3 as real and imaginary vectors.
+	   Each middle pass: w1 to w3 for each of its n/4 butterflies, broadcast as it runs. */
+	size_t count = (size_t)6*(N/4);
+	for (int n = N/4; n >= 8; n /= 4) count += (size_t)6*(n/4);
+	setup->twiddles = (float *)stockham_aligned_malloc(count*sizeof(float));
+	if (!setup->twiddles) {
+		free(setup);
+		return NULL;
+	}
+
+	float *w = setup->twiddles;
+	for (int p = 0; p < N/4; p += 4, w += 24) {
+		for (int lane = 0; lane < 4; ++lane) {
+			float scalar[6];
+			computeTwiddles(N, p + lane, scalar);
+			for (int i = 0; i < 6; ++i) w[4*i + lane] = scalar[i];
+		}
+	}
+	for (int n = N/4; n >= 8; n /= 4) {
+		for (int p = 0; p < n/4; ++p, w += 6) computeTwiddles(n, p, w);
+	}
+	return setup;
+}
+
+void stockham_destroy_setup(Stockham_Setup *setup) {
+	if (!setup) return;
+	stockham_aligned_free(setup->twiddles);
+	free(setup);
+}
+
+void stockham_transform(Stockham_Setup *setup, const float *input, float *output, float *work, stockham_direction_t direction) {
+	const int N = setup->N, backward = (direction == STOCKHAM_BACKWARD);
+	const int hasRadix2 = ((N >> (2*setup->radix4Passes)) == 2);
+	const int middlePasses = setup->radix4Passes - (hasRadix2 ? 1 : 2);
+
+	/* The passes ping-pong between work and output, and the last one has to read from work */
+	float *buffers[2] = {work, output};
+	int current = (middlePasses % 2 == 0) ? 0 : 1;
+	if (buffers[current] == input) {
+		memcpy(work, input, 2*(size_t)N*sizeof(float));
+		input = work;
+	}
+
+	const float *twiddles = setup->twiddles;
+	firstPass(N, input, buffers[current], buffers[current] + N, twiddles, backward);
+	twiddles += 6*(N/4);
+
+	int n = N/4, s = 4;
+	for (int pass = 0; pass < middlePasses; ++pass, n /= 4, s *= 4) {
+		float *x = buffers[current], *y = buffers[1 - current];
+		middlePass(n, s, x, x + N, y, y + N, twiddles);
+		twiddles += 6*(n/4);
+		current = 1 - current;
+	}
+
+	if (hasRadix2) lastPass2(N, work, work + N, output, backward);
+	else lastPass4(N, work, work + N, output, backward);
+}
+
+void *stockham_aligned_malloc(size_t nb_bytes) {
+	void *p0 = malloc(nb_bytes + ALIGNMENT);
+	if (!p0) return NULL;
+	void *p = (void *)(((uintptr_t)p0 + ALIGNMENT) & ~(uintptr_t)(ALIGNMENT - 1));
+	*((void **)p - 1) = p0;
+	return p;
+}
+
+void stockham_aligned_free(void *p) {
+	if (p) free(*((void **)p - 1));
+}
+
+int stockham_simd_size(void) {
+	return SIMD_SZ;
+}
@@ -0,0 +1,39 @@
+/* Deranger's own power-of-two complex FFT, one of the stretch's build-time FFT backends.
+
+   Ordered, unnormalised complex transforms of power-of-two sizes from 16 up, on SSE, NEON,
+   or plain C. SignalSmith's platform/fft-stockham.h puts Pow2FFT<float> on it, and
+   tests/StockhamFFTCheck.cpp checks it against a direct DFT. */
+
+#ifndef STOCKHAM_H
+#define STOCKHAM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Stockham_Setup Stockham_Setup;
+
+typedef enum { STOCKHAM_FORWARD, STOCKHAM_BACKWARD } stockham_direction_t;
+
+/* Returns NULL unless N is a power of two >= 16 */
+Stockham_Setup *stockham_new_setup(int N);
+void stockham_destroy_setup(Stockham_Setup *setup);
+
+/* input, output and work each hold N interleaved complex values and are aligned to
+   stockham_simd_size() floats. input may be the same buffer as output. Neither direction
+   scales, so a round trip multiplies by N. */
+void stockham_transform(Stockham_Setup *setup, const float *input, float *output, float *work, stockham_direction_t direction);
+
+void *stockham_aligned_malloc(size_t nb_bytes);
+void stockham_aligned_free(void *p);
+
+/* Floats per vector; 4 with SSE or NEON, 1 when built with STOCKHAM_SIMD_DISABLE */
+int stockham_simd_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STOCKHAM_H */
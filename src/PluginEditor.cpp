@@ -14,28 +14,23 @@ DerangerAudioProcessorEditor::DerangerAudioProcessorEditor(
   addAndMakeVisible(visualizer);
   visualizer.toBack();
 
-  auto *rev = findReverbProcessor();
-  addAndConfigureSlider(reverbRoomSizeSlider, reverbRoomSizeLabel, reverbRoomSizeToggle, "RV Size", 0.0f, 1.0f, rev->getParameters().roomSize);
-  addAndConfigureSlider(reverbWetSlider, reverbWetLabel, reverbWetToggle, "RV Wet", 0.0f, 1.0f, rev->getParameters().wetLevel);
-  addAndConfigureSlider(reverbDampingSlider, reverbDampingLabel, reverbDampingToggle, "RV Damping", 0.0f, 1.0f, rev->getParameters().damping);
-  
-  auto *del = findDelayProcessor();
-  addAndConfigureSlider(delayTimeSlider, delayTimeLabel, delayTimeToggle, "DL Time", 0.05, 3, del->getDelayTime()/audioProcessor.getSampleRate());
-  addAndConfigureSlider(delayFeedbackSlider, delayFeedbackLabel, delayFeedbackToggle, "DL Feedback", 0.0f, 1.0f, del->getFeedback());
-
-  auto *flg = findFlangerProcessor();
-  addAndConfigureSlider(flangerDelaySlider, flangerDelayLabel, flangerDelayToggle, "FL Time", 1.0f, 20.0f, flg->getDelay());
-  addAndConfigureSlider(flangerDepthSlider, flangerDepthLabel, flangerDepthToggle, "FL Depth", 0.0f, 1.0f, flg->getLFODepth());
-  addAndConfigureSlider(flangerFeedbackSlider, flangerFeedbackLabel, flangerFeedbackToggle, "FL Feedback", 0.0f, 1.0f, flg->getFeedback());
-
-  p.getRack().getRoot().onEffectParamsChanged = [this](RackEffect* effect, const std::string& name)
-  {
-    if (effect) {
-      updateSliderValues(*effect, name);
-      this->audioProcessor.applyEffectParamChanges(effect->getParameterMap());
-    }
-  };
-  
+  p.withActiveRack([this](auto& rack) {
+    auto *rev = rack.template findEffect<ReverbProcessor>("Reverb");
+    addAndConfigureSlider(reverbRoomSizeSlider, reverbRoomSizeLabel, reverbRoomSizeToggle, "RV Size", 0.0f, 1.0f, rev->getParameters().roomSize);
+    addAndConfigureSlider(reverbWetSlider, reverbWetLabel, reverbWetToggle, "RV Wet", 0.0f, 1.0f, rev->getParameters().wetLevel);
+    addAndConfigureSlider(reverbDampingSlider, reverbDampingLabel, reverbDampingToggle, "RV Damping", 0.0f, 1.0f, rev->getParameters().damping);
+
+    auto *del = rack.template findEffect<DelayProcessor>("Delay");
+    addAndConfigureSlider(delayTimeSlider, delayTimeLabel, delayTimeToggle, "DL Time", 0.05, 3, del->getDelayTime()/audioProcessor.getSampleRate());
+    addAndConfigureSlider(delayFeedbackSlider, delayFeedbackLabel, delayFeedbackToggle, "DL Feedback", 0.0f, 1.0f, del->getFeedback());
+
+    auto *flg = rack.template findEffect<FlangerProcessor>("Flanger");
+    addAndConfigureSlider(flangerDelaySlider, flangerDelayLabel, flangerDelayToggle, "FL Time", 1.0f, 20.0f, flg->getDelay());
+    addAndConfigureSlider(flangerDepthSlider, flangerDepthLabel, flangerDepthToggle, "FL Depth", 0.0f, 1.0f, flg->getLFODepth());
+    addAndConfigureSlider(flangerFeedbackSlider, flangerFeedbackLabel, flangerFeedbackToggle, "FL Feedback", 0.0f, 1.0f, flg->getFeedback());
+  });
+
+  // Also called when a randomise has finished morphing, with the parameters at its values
   p.onStateChanged = [this]()
   {
       updateControlsFromParameters();
@@ -44,15 +39,15 @@ DerangerAudioProcessorEditor::DerangerAudioProcessorEditor(
   
   // === Routing and Random Controls ===
   isParallelButton.setButtonText("||");
-  isParallelButton.setToggleState(p.getRack().getRoot().getParallel(), juce::dontSendNotification);
+  isParallelButton.setToggleState(p.withActiveRack([](auto& rack) { return rack.getRoot().getParallel(); }), juce::dontSendNotification);
   addAndMakeVisible(isParallelButton);
 
   randomizeButton.setButtonText("<?>");
-  randomizeButton.setToggleState(p.getRack().getRandomize(), juce::dontSendNotification);
+  randomizeButton.setToggleState(p.withActiveRack([](auto& rack) { return rack.getRandomize(); }), juce::dontSendNotification);
   addAndMakeVisible(randomizeButton);
 
   stretchButton.setButtonText(juce::String::fromUTF8("↑↓"));
-  stretchButton.setToggleState(p.getRack().getStretchEnabled(), juce::dontSendNotification);
+  stretchButton.setToggleState(p.withActiveRack([](auto& rack) { return rack.getStretchEnabled(); }), juce::dontSendNotification);
   addAndMakeVisible(stretchButton);
 
   // Stretch Semitone Knob
@@ -60,7 +55,7 @@ DerangerAudioProcessorEditor::DerangerAudioProcessorEditor(
   stretchSemitoneKnob.setSliderStyle(juce::Slider::Rotary);
   stretchSemitoneKnob.setTextBoxStyle(juce::Slider::TextBoxRight, false, 28, 18);
   stretchSemitoneKnob.setRange(-12, 12, 1);
-  stretchSemitoneKnob.setValue(audioProcessor.getRack().getStretchSemitones());
+  stretchSemitoneKnob.setValue(p.withActiveRack([](auto& rack) { return rack.getStretchSemitones(); }));
   stretchSemitoneKnob.setNumDecimalPlacesToDisplay(0);
   stretchSemitoneKnob.setColour(juce::Slider::thumbColourId, juce::Colours::aqua);
   stretchSemitoneKnob.setColour(juce::Slider::rotarySliderFillColourId, juce::Colours::aqua);
@@ -70,7 +65,7 @@ DerangerAudioProcessorEditor::DerangerAudioProcessorEditor(
 
   stretchSemitoneKnob.onValueChange = [this]() {
       auto semitone = static_cast<float>(stretchSemitoneKnob.getValue());
-      audioProcessor.getRack().setStretchSemitones(semitone);
+      audioProcessor.forEachRack([semitone](auto& rack) { rack.setStretchSemitones(semitone); });
       audioProcessor.applyEffectParamChanges({
         {"stretchSemitones", semitone}
       });
@@ -85,18 +80,30 @@ DerangerAudioProcessorEditor::DerangerAudioProcessorEditor(
     addAndMakeVisible(bpmLabel);
   }
 
+  stretchAsyncButton.setButtonText("Worker");
+  stretchAsyncButton.setTooltip("Runs the pitch shifter on its own thread, one block behind.\n"
+                                "Applies on restart: when the host next prepares the plugin.");
+  stretchAsyncButton.setToggleState(p.parameters.getRawParameterValue("stretchAsync")->load() > 0.5f, juce::dontSendNotification);
+  addAndMakeVisible(stretchAsyncButton);
+
+  stretchCostLabel.setColour(juce::Label::textColourId, juce::Colours::antiquewhite);
+  stretchCostLabel.setJustificationType(juce::Justification::centredLeft);
+  stretchCostLabel.attachToComponent(&stretchButton, false);
+  addAndMakeVisible(stretchCostLabel);
+
   startTimerHz(10);
 
   isParallelButton.onStateChange = [this]() {
     bool state = isParallelButton.getToggleState();
-    audioProcessor.getRack().getRoot().setParallel(state);
+    audioProcessor.forEachRack([state](auto& rack) { rack.getRoot().setParallel(state); });
     audioProcessor.applyEffectParamChanges({
       {"isParallel", static_cast<bool>(state)}
     });
   };
 
   randomizeButton.onStateChange = [this]() {
-    audioProcessor.getRack().setRandomize(randomizeButton.getToggleState());
+    const bool state = randomizeButton.getToggleState();
+    audioProcessor.forEachRack([state](auto& rack) { rack.setRandomize(state); });
     audioProcessor.applyEffectParamChanges({
       {"randomize", static_cast<bool>(randomizeButton.getToggleState())}
     });
@@ -104,139 +111,116 @@ DerangerAudioProcessorEditor::DerangerAudioProcessorEditor(
 
   stretchButton.onStateChange = [this]() {
     bool state = stretchButton.getToggleState();
-    audioProcessor.getRack().setStretchEnabled(state);
+    audioProcessor.forEachRack([state](auto& rack) { rack.setStretchEnabled(state); });
     stretchSemitoneKnob.setEnabled(state);
     audioProcessor.applyEffectParamChanges({
       {"stretchEnabled", static_cast<bool>(state)}
     });
   };
 
+  stretchAsyncButton.onClick = [this]() {
+    audioProcessor.applyEffectParamChanges({
+      {"stretchAsync", static_cast<bool>(stretchAsyncButton.getToggleState())}
+    });
+  };
+
   // === Reverb Sliders ===
     reverbRoomSizeSlider.onValueChange = [this]() {
-      if (auto* reverb = findReverbProcessor())
-      {
-        auto params = reverb->getParameters();
-        params.roomSize = static_cast<float>(reverbRoomSizeSlider.getValue());
-        reverb->setParameters(params);
-        audioProcessor.applyEffectParamChanges({
-            {"roomSize", params.roomSize}
-        });
-      }
+      const auto roomSize = static_cast<float>(reverbRoomSizeSlider.getValue());
+      audioProcessor.applyEffectParamChanges({
+          {"roomSize", roomSize}
+      });
     };
 
     reverbWetSlider.onValueChange = [this]() {
-      if (auto* reverb = findReverbProcessor())
-      {
-        auto params = reverb->getParameters();
-        params.wetLevel = static_cast<float>(reverbWetSlider.getValue());
-        reverb->setParameters(params);
-        audioProcessor.applyEffectParamChanges({
-            {"wetLevel", params.wetLevel}
-        });
-      }
+      const auto wetLevel = static_cast<float>(reverbWetSlider.getValue());
+      audioProcessor.applyEffectParamChanges({
+          {"wetLevel", wetLevel}
+      });
     };
 
     reverbDampingSlider.onValueChange = [this]() {
-      if (auto* reverb = findReverbProcessor())
-      {
-        auto params = reverb->getParameters();
-        params.damping = static_cast<float>(reverbDampingSlider.getValue());
-        reverb->setParameters(params);
-        audioProcessor.applyEffectParamChanges({
-            {"damping", params.damping}
-        });
-      }
+      const auto damping = static_cast<float>(reverbDampingSlider.getValue());
+      audioProcessor.applyEffectParamChanges({
+          {"damping", damping}
+      });
     };
 
     // === Reverb Toggles ===
     reverbRoomSizeToggle.onClick = [this]() {
-      if (auto* reverb = findReverbProcessor())
-          reverb->setRoomSizeRandomize(reverbRoomSizeToggle.getToggleState());
+      const bool state = reverbRoomSizeToggle.getToggleState();
+      audioProcessor.forEachEffect<ReverbProcessor>("Reverb", [state](auto& reverb) { reverb.setRoomSizeRandomize(state); });
     };
 
     reverbWetToggle.onClick = [this]() {
-      if (auto* reverb = findReverbProcessor())
-          reverb->setWetLevelRandomize(reverbWetToggle.getToggleState());
+      const bool state = reverbWetToggle.getToggleState();
+      audioProcessor.forEachEffect<ReverbProcessor>("Reverb", [state](auto& reverb) { reverb.setWetLevelRandomize(state); });
     };
 
     reverbDampingToggle.onClick = [this]() {
-      if (auto* reverb = findReverbProcessor())
-          reverb->setDampingRandomize(reverbDampingToggle.getToggleState());
+      const bool state = reverbDampingToggle.getToggleState();
+      audioProcessor.forEachEffect<ReverbProcessor>("Reverb", [state](auto& reverb) { reverb.setDampingRandomize(state); });
     };
 
     // === Delay Sliders ===
     delayTimeSlider.onValueChange = [this]() {
-      if (auto* delay = findDelayProcessor())
-      {
-        delay->setDelayTime(static_cast<float>(delayTimeSlider.getValue()
-                                    * audioProcessor.getSampleRate()));
-        audioProcessor.applyEffectParamChanges({
-            {"delayTime", delayTimeSlider.getValue()}
-        });
-      }
+      audioProcessor.applyEffectParamChanges({
+          {"delayTime", delayTimeSlider.getValue()}
+      });
     };
     delayFeedbackSlider.onValueChange = [this]() {
-      if (auto* delay = findDelayProcessor())
-      {
-        delay->setFeedback(static_cast<float>(delayFeedbackSlider.getValue()));
-        audioProcessor.applyEffectParamChanges({
-            {"delayFeedback", delay->getFeedback()}
-        });
-      }
+      const auto feedback = static_cast<float>(delayFeedbackSlider.getValue());
+      audioProcessor.applyEffectParamChanges({
+          {"delayFeedback", feedback}
+      });
     };
 
     // === Delay Toggles ===
     delayTimeToggle.onClick = [this]() {
-      if (auto* delay = findDelayProcessor())
-          delay->setDelayTimeRandomize(delayTimeToggle.getToggleState());
+      const bool state = delayTimeToggle.getToggleState();
+      audioProcessor.forEachEffect<DelayProcessor>("Delay", [state](auto& delay) { delay.setDelayTimeRandomize(state); });
     };
     delayFeedbackToggle.onClick = [this]() {
-      if (auto* delay = findDelayProcessor())
-          delay->setFeedbackRandomize(delayFeedbackToggle.getToggleState());
+      const bool state = delayFeedbackToggle.getToggleState();
+      audioProcessor.forEachEffect<DelayProcessor>("Delay", [state](auto& delay) { delay.setFeedbackRandomize(state); });
     };
 
     // === Flanger Sliders ===
     flangerDelaySlider.onValueChange = [this]() {
-      if (auto* flanger = findFlangerProcessor()) {
-        flanger->setDelay(static_cast<float>(flangerDelaySlider.getValue()));
-        audioProcessor.applyEffectParamChanges({
-            {"flangerDelay", flanger->getDelay()}
-        });
-      }
+      const auto delayMs = static_cast<float>(flangerDelaySlider.getValue());
+      audioProcessor.applyEffectParamChanges({
+          {"flangerDelay", delayMs}
+      });
     };
 
     flangerDepthSlider.onValueChange = [this]() {
-      if (auto* flanger = findFlangerProcessor()) {
-        flanger->setLFODepth(static_cast<float>(flangerDepthSlider.getValue()));
-        audioProcessor.applyEffectParamChanges({
-            {"flangerDepth", flanger->getLFODepth()}
-        });
-      }
+      const auto depth = static_cast<float>(flangerDepthSlider.getValue());
+      audioProcessor.applyEffectParamChanges({
+          {"flangerDepth", depth}
+      });
     };
 
     flangerFeedbackSlider.onValueChange = [this]() {
-      if (auto* flanger = findFlangerProcessor()) {
-        flanger->setFeedback(static_cast<float>(flangerFeedbackSlider.getValue()));
-        audioProcessor.applyEffectParamChanges({
-            {"flangerFeedback", flanger->getFeedback()}
-        });
-      }
+      const auto feedback = static_cast<float>(flangerFeedbackSlider.getValue());
+      audioProcessor.applyEffectParamChanges({
+          {"flangerFeedback", feedback}
+      });
     };
 
     // === Flanger Toggles ===
     flangerDelayToggle.onClick = [this]() {
-      if (auto* flanger = findFlangerProcessor())
-          flanger->setDelayRandomize(flangerDelayToggle.getToggleState());
+      const bool state = flangerDelayToggle.getToggleState();
+      audioProcessor.forEachEffect<FlangerProcessor>("Flanger", [state](auto& flanger) { flanger.setDelayRandomize(state); });
     };
 
     flangerDepthToggle.onClick = [this]() {
-      if (auto* flanger = findFlangerProcessor())
-          flanger->setDepthRandomize(flangerDepthToggle.getToggleState());
+      const bool state = flangerDepthToggle.getToggleState();
+      audioProcessor.forEachEffect<FlangerProcessor>("Flanger", [state](auto& flanger) { flanger.setDepthRandomize(state); });
     };
 
     flangerFeedbackToggle.onClick = [this]() {
-      if (auto* flanger = findFlangerProcessor())
-          flanger->setFeedbackRandomize(flangerFeedbackToggle.getToggleState());
+      const bool state = flangerFeedbackToggle.getToggleState();
+      audioProcessor.forEachEffect<FlangerProcessor>("Flanger", [state](auto& flanger) { flanger.setFeedbackRandomize(state); });
     };
 
 }
@@ -275,6 +259,7 @@ void DerangerAudioProcessorEditor::updateControlsFromParameters()
     stretchButton.setToggleState(getBoolParam("stretchEnabled"), nomsg);
     stretchSemitoneKnob.setValue(getFloatParam("stretchSemitones"), nomsg);
     stretchSemitoneKnob.setEnabled(getBoolParam("stretchEnabled"));
+    stretchAsyncButton.setToggleState(getBoolParam("stretchAsync"), nomsg);
 }
 
 void DerangerAudioProcessorEditor::timerCallback()
@@ -283,11 +268,23 @@ void DerangerAudioProcessorEditor::timerCallback()
     float bpm = audioProcessor.getCurrentBPM();  // Atomic safe read
     bpmLabel.setText("BPM: " + juce::String(bpm, 2), juce::dontSendNotification);
   }
+
+  const auto& stretchCost = audioProcessor.getStretchCost();
+  const auto underruns = audioProcessor.getStretchUnderrunSamples();
+  juce::String costText = "Peak " + juce::String(juce::roundToInt(stretchCost.getPeak() * 100.0f)) + "%";
+  if (underruns > 0)
+    costText << ", " << juce::String(underruns) << " lost";
+  stretchCostLabel.setText(costText, juce::dontSendNotification);
+  stretchCostLabel.setTooltip("Stretch cost per block:\n" + stretchCost.toString()
+                              + "\nWorker underruns: " + juce::String(underruns) + " samples");
+
+  const bool asyncRequested = audioProcessor.parameters.getRawParameterValue("stretchAsync")->load() > 0.5f;
+  stretchAsyncButton.setButtonText(asyncRequested != audioProcessor.getStretchAsyncInUse() ? "Worker (on restart)" : "Worker");
   repaint();
 }
 
 DerangerAudioProcessorEditor::~DerangerAudioProcessorEditor() {
-    audioProcessor.getRack().getRoot().onEffectParamsChanged = nullptr;
+    audioProcessor.onStateChanged = nullptr;
     reverbRoomSizeToggle.setLookAndFeel(nullptr);
     reverbWetToggle.setLookAndFeel(nullptr);
     reverbDampingToggle.setLookAndFeel(nullptr);
@@ -387,6 +384,9 @@ void DerangerAudioProcessorEditor::resized() {
   auto knobArea = stretchGroup.removeFromLeft(rowHeight + 16); // knob size
   stretchSemitoneKnob.setBounds(knobArea.withSizeKeepingCentre(knobSize, knobSize));
 
+  // A row of its own, with room for the pending note
+  stretchAsyncButton.setBounds(row().withLeft(middle.getX()).reduced(4));
+
   static bool snapshotTaken = false;
   if (!snapshotTaken) {
       juce::MessageManager::callAsync([this]() {
@@ -456,45 +456,3 @@ void DerangerAudioProcessorEditor::addAndConfigureSlider(juce::Slider& slider, j
     addAndMakeVisible(toggle);
 
 }
-
-void DerangerAudioProcessorEditor::updateSliderValues(RackEffect& effect, const std::string& effectName)
-{
-  auto nomsg = juce::dontSendNotification;
-
-  if (effectName == "Reverb") {
-    auto *rev = dynamic_cast<ReverbProcessor *>(&effect);
-    juce::dsp::Reverb::Parameters par = rev->getParameters();
-    
-    reverbRoomSizeSlider.setValue(par.roomSize, nomsg);
-    reverbDampingSlider.setValue(par.damping, nomsg);
-    reverbWetSlider.setValue(par.wetLevel, nomsg);
-
-  } else if (effectName == "Delay") {
-    auto *del = dynamic_cast<DelayProcessor *>(&effect);
-
-    delayTimeSlider.setValue(del->getTargetDelayTime() / audioProcessor.getSampleRate(), nomsg);
-    delayFeedbackSlider.setValue(del->getFeedback(), nomsg);
-
-  } else if (effectName == "Flanger") {
-    auto *flg = dynamic_cast<FlangerProcessor *>(&effect);
-
-    flangerDelaySlider.setValue(flg->getDelay(), nomsg);
-    flangerDepthSlider.setValue(flg->getLFODepth(), nomsg);
-    flangerFeedbackSlider.setValue(flg->getFeedback(), nomsg);
-  }
-}
-
-ReverbProcessor* DerangerAudioProcessorEditor::findReverbProcessor()
-{
-    return dynamic_cast<ReverbProcessor*>(audioProcessor.getRack().findProcessor("Reverb"));
-}
-
-DelayProcessor* DerangerAudioProcessorEditor::findDelayProcessor()
-{
-    return dynamic_cast<DelayProcessor*>(audioProcessor.getRack().findProcessor("Delay"));
-}
-
-FlangerProcessor* DerangerAudioProcessorEditor::findFlangerProcessor()
-{
-    return dynamic_cast<FlangerProcessor*>(audioProcessor.getRack().findProcessor("Flanger"));
-}
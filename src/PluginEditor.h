@@ -22,10 +22,6 @@ class DerangerAudioProcessorEditor : public juce::AudioProcessorEditor,
   void timerCallback() override;
   void takeSnapshotOfGUI (juce::Component* comp);
 
-  DelayProcessor*   findDelayProcessor();
-  ReverbProcessor*  findReverbProcessor();
-  FlangerProcessor* findFlangerProcessor(); // TODO: Generalize these functions
-
  private:
   // This reference is provided as a quick way for your editor to
   // access the processor object that created it.
@@ -35,6 +31,8 @@ class DerangerAudioProcessorEditor : public juce::AudioProcessorEditor,
   juce::ToggleButton  randomizeButton;
   juce::ToggleButton  stretchButton;
   juce::Slider        stretchSemitoneKnob;
+  // Only takes effect when the host next prepares the plugin, which the button text says while it's pending
+  juce::ToggleButton  stretchAsyncButton;
 
   // Reverb Sliders
   juce::Slider        reverbRoomSizeSlider, reverbWetSlider, reverbDampingSlider;
@@ -56,11 +54,13 @@ class DerangerAudioProcessorEditor : public juce::AudioProcessorEditor,
   juce::Label bpmLabel;
   double _currentBpm = 0.0f;
 
+  // The pitch shifter's worst block so far; the tooltip has the whole histogram
+  juce::Label stretchCostLabel;
+
   // Sliders helpers
   void addAndConfigureSlider(juce::Slider& slider, juce::Label& label, juce::ToggleButton& toggle,
                              const juce::String& name, float min, float max, float initial);
 
-  void updateSliderValues(RackEffect& effect, const std::string& effectName);
   void updateControlsFromParameters();
 
   juce::GroupComponent sliderContainer {"Sliders" };
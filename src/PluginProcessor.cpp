@@ -1,6 +1,22 @@
 #include "./PluginProcessor.h"
 #include "PluginEditor.h"
 
+// Order matches ModulationMatrix::Source and ::Destination
+static juce::StringArray modSourceNames()
+{
+    return { "Off", "LFO 1", "LFO 2", "Input Envelope", "Sidechain Envelope", "Random 1", "Random 2" };
+}
+
+static juce::StringArray modTargetNames()
+{
+    return { "Delay Time", "Delay Feedback", "Flanger Delay", "Flanger Depth", "Flanger Feedback", "Reverb Wet" };
+}
+
+// Order matches DerangerAudioProcessor::Randomised
+static const char* const randomisedParameterIds[] = {
+    "roomSize", "damping", "wetLevel", "delayTime", "delayFeedback", "flangerDelay", "flangerDepth", "flangerFeedback"
+};
+
 //==============================================================================
 DerangerAudioProcessor::DerangerAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -8,43 +24,104 @@ DerangerAudioProcessor::DerangerAudioProcessor()
     {
       std::make_unique<juce::AudioParameterFloat>("delayTime", "Delay Time", 0.05f, 3.0f, 1.0f),
       std::make_unique<juce::AudioParameterFloat>("delayFeedback", "Delay Feedback", 0.0f, 1.0f, 0.7f),
+      std::make_unique<juce::AudioParameterChoice>("delayMode", "Delay Stereo Mode",
+                                                   juce::StringArray { "Independent", "Ping-Pong", "Cross-Feed", "Mid/Side" }, 0),
+      std::make_unique<juce::AudioParameterFloat>("delayStereoAmount", "Delay Stereo Amount", 0.0f, 1.0f, 0.3f),
       std::make_unique<juce::AudioParameterFloat>("roomSize", "Room Size", 0.0f, 1.0f, 0.6f),
       std::make_unique<juce::AudioParameterFloat>("wetLevel", "Wet Level", 0.0f, 1.0f, 0.9f),
       std::make_unique<juce::AudioParameterFloat>("damping", "Damping", 0.0f, 1.0f, 0.5f),
+      std::make_unique<juce::AudioParameterChoice>("reverbEngine", "Reverb Engine",
+                                                   juce::StringArray { "Freeverb", "FDN 8", "FDN 16" }, 0),
+      // Half rate loses the top octave for 10-15% less reverb CPU; quarter saves 35-50%
+      std::make_unique<juce::AudioParameterChoice>("reverbRate", "Reverb Rate",
+                                                   juce::StringArray { "Full", "Half (Darker, Barely Cheaper)", "Quarter (Darker, Cheaper)" }, 0),
+      std::make_unique<juce::AudioParameterFloat>("convolutionMix", "Convolution Mix", 0.0f, 1.0f, 0.3f),
       std::make_unique<juce::AudioParameterFloat>("flangerFeedback", "Flanger Feedback", 0.0f, 1.0f, 0.66f),
       std::make_unique<juce::AudioParameterFloat>("flangerDelay", "Flanger Delay", 1.0f, 20.0f, 10.0f),
       std::make_unique<juce::AudioParameterFloat>("flangerDepth", "Flanger Depth", 0.0f, 1.0f, 0.6f),
+      std::make_unique<juce::AudioParameterChoice>("flangerShape", "Flanger LFO Shape",
+                                                   juce::StringArray { "Sine", "Triangle", "Random" }, 0),
+      std::make_unique<juce::AudioParameterChoice>("flangerInterpolation", "Flanger Interpolation",
+                                                   juce::StringArray { "Linear", "Cubic Lagrange", "Allpass" }, 0),
+      std::make_unique<juce::AudioParameterBool>("flangerThroughZero", "Flanger Through-Zero", false),
       std::make_unique<juce::AudioParameterBool>("isParallel", "Is Parallel", false),
       std::make_unique<juce::AudioParameterBool>("randomize", "Randomize", true),
+      std::make_unique<juce::AudioParameterFloat>("morphBeats", "Randomize Morph Beats", 0.0f, 8.0f, 4.0f),
       std::make_unique<juce::AudioParameterBool>("stretchEnabled", "Stretch Enabled", true),
       std::make_unique<juce::AudioParameterFloat>("stretchSemitones", "Stretch Semitones", -12.0f, 12.0f, -5.0f),
+      std::make_unique<juce::AudioParameterBool>("stretchSplit", "Stretch Split Computation", false),
+      // Starting or stopping the worker waits for prepareToPlay(), so hosts don't get to automate it
+      std::make_unique<juce::AudioParameterBool>("stretchAsync", "Stretch On Worker Thread (Applies On Restart)", false,
+                                                 juce::AudioParameterBoolAttributes().withAutomatable(false)),
+      std::make_unique<juce::AudioParameterChoice>("stretchQuality", "Stretch Quality",
+                                                   juce::StringArray { "Cheap", "Default", "High" }, 1),
+      std::make_unique<juce::AudioParameterBool>("stretchLinked", "Stretch Linked Stereo", false),
+      std::make_unique<juce::AudioParameterFloat>("duckDepth", "Sidechain Duck Depth", 0.0f, 1.0f, 0.0f),
+      std::make_unique<juce::AudioParameterFloat>("duckAttack", "Sidechain Duck Attack", 0.1f, 100.0f, 5.0f),
+      std::make_unique<juce::AudioParameterFloat>("duckRelease", "Sidechain Duck Release", 10.0f, 1000.0f, 150.0f),
+      std::make_unique<juce::AudioParameterChoice>("modInterval", "Mod Control Interval",
+                                                   juce::StringArray { "16", "32", "64", "128" }, 1),
+      std::make_unique<juce::AudioParameterFloat>("lfo1Rate", "LFO 1 Rate", 0.01f, 20.0f, 0.5f),
+      std::make_unique<juce::AudioParameterChoice>("lfo1Shape", "LFO 1 Shape", juce::StringArray { "Sine", "Triangle" }, 0),
+      std::make_unique<juce::AudioParameterFloat>("lfo2Rate", "LFO 2 Rate", 0.01f, 20.0f, 2.0f),
+      std::make_unique<juce::AudioParameterChoice>("lfo2Shape", "LFO 2 Shape", juce::StringArray { "Sine", "Triangle" }, 1),
+      std::make_unique<juce::AudioParameterFloat>("randomRate", "Random Walk Rate", 0.01f, 10.0f, 0.5f),
+      std::make_unique<juce::AudioParameterChoice>("mod1Source", "Mod 1 Source", modSourceNames(), 0),
+      std::make_unique<juce::AudioParameterChoice>("mod1Target", "Mod 1 Target", modTargetNames(), 0),
+      std::make_unique<juce::AudioParameterFloat>("mod1Depth", "Mod 1 Depth", -1.0f, 1.0f, 0.0f),
+      std::make_unique<juce::AudioParameterChoice>("mod2Source", "Mod 2 Source", modSourceNames(), 0),
+      std::make_unique<juce::AudioParameterChoice>("mod2Target", "Mod 2 Target", modTargetNames(), 0),
+      std::make_unique<juce::AudioParameterFloat>("mod2Depth", "Mod 2 Depth", -1.0f, 1.0f, 0.0f),
+      std::make_unique<juce::AudioParameterChoice>("mod3Source", "Mod 3 Source", modSourceNames(), 0),
+      std::make_unique<juce::AudioParameterChoice>("mod3Target", "Mod 3 Target", modTargetNames(), 0),
+      std::make_unique<juce::AudioParameterFloat>("mod3Depth", "Mod 3 Depth", -1.0f, 1.0f, 0.0f),
+      std::make_unique<juce::AudioParameterChoice>("mod4Source", "Mod 4 Source", modSourceNames(), 0),
+      std::make_unique<juce::AudioParameterChoice>("mod4Target", "Mod 4 Target", modTargetNames(), 0),
+      std::make_unique<juce::AudioParameterFloat>("mod4Depth", "Mod 4 Depth", -1.0f, 1.0f, 0.0f),
     }),
       AudioProcessor(
           BusesProperties()
 #if !JucePlugin_IsMidiEffect
 #if !JucePlugin_IsSynth
               .withInput("Input", juce::AudioChannelSet::stereo(), true)
+              .withInput("Sidechain", juce::AudioChannelSet::stereo(), false)
 #endif
               .withOutput("Output", juce::AudioChannelSet::stereo(), true)
 #endif
       )
 #endif
 {
-
-  /* NOTE: Currently, all the effects (reverb, delay, flanger)
-           must always be added to the rack: */
-  rack.addFlanger(parameters);
-  rack.addDelay  (parameters);
-  rack.addReverb (parameters);
-  rack.addEnd();
+  forEachRack([this](auto& r) { buildRack(r); });
 
   rack.printTree(&rack.getRoot(), 0);
 
   initializeParameters(parameters);
+
+  startTimerHz(10);
 }
 
 DerangerAudioProcessor::~DerangerAudioProcessor() {}
 
+template <typename SampleType>
+void DerangerAudioProcessor::buildRack(RackProcessor<SampleType>& target)
+{
+  /* NOTE: Currently, all the effects (reverb, delay, flanger)
+           must always be added to the rack: */
+  target.addFlanger(parameters);
+  target.addDelay  (parameters);
+  target.addReverb (parameters);
+  target.addConvolution(parameters); // passes audio through until an impulse response is loaded
+  target.addEnd();
+
+  // Found by name once here, so the audio thread never has to
+  auto& fx = handlesFor(target);
+  fx.delay = target.template findEffect<DelayProcessor>("Delay");
+  fx.reverb = target.template findEffect<ReverbProcessor>("Reverb");
+  fx.flanger = target.template findEffect<FlangerProcessor>("Flanger");
+  fx.convolution = target.template findEffect<ConvolutionReverbProcessor>("Convolution");
+  jassert(fx.delay != nullptr && fx.reverb != nullptr && fx.flanger != nullptr && fx.convolution != nullptr);
+}
+
 //======= States and Parameters ================================================
 
 void DerangerAudioProcessor::initializeParameters(juce::AudioProcessorValueTreeState& params, bool updateEffects)
@@ -52,72 +129,301 @@ void DerangerAudioProcessor::initializeParameters(juce::AudioProcessorValueTreeS
     randomizeParam = params.getRawParameterValue("randomize");
     stretchEnabledParam = params.getRawParameterValue("stretchEnabled");
     stretchSemitonesParam = params.getRawParameterValue("stretchSemitones");
+    stretchSplitParam = params.getRawParameterValue("stretchSplit");
+    stretchAsyncParam = params.getRawParameterValue("stretchAsync");
+    stretchQualityParam = params.getRawParameterValue("stretchQuality");
+    stretchLinkedParam = params.getRawParameterValue("stretchLinked");
     isParallelParam = params.getRawParameterValue("isParallel");
 
     delayTimeParam = params.getRawParameterValue("delayTime");
     delayFeedbackParam = params.getRawParameterValue("delayFeedback");
+    delayModeParam = params.getRawParameterValue("delayMode");
+    delayStereoAmountParam = params.getRawParameterValue("delayStereoAmount");
 
     roomSizeParam = params.getRawParameterValue("roomSize");
     wetLevelParam = params.getRawParameterValue("wetLevel");
     dampingParam = params.getRawParameterValue("damping");
+    reverbEngineParam = params.getRawParameterValue("reverbEngine");
+    reverbRateParam = params.getRawParameterValue("reverbRate");
+    convolutionMixParam = params.getRawParameterValue("convolutionMix");
 
     flangerFeedbackParam = params.getRawParameterValue("flangerFeedback");
     flangerDelayParam = params.getRawParameterValue("flangerDelay");
     flangerDepthParam = params.getRawParameterValue("flangerDepth");
+    flangerShapeParam = params.getRawParameterValue("flangerShape");
+    flangerInterpolationParam = params.getRawParameterValue("flangerInterpolation");
+    flangerThroughZeroParam = params.getRawParameterValue("flangerThroughZero");
+
+    morphBeatsParam = params.getRawParameterValue("morphBeats");
+
+    duckDepthParam = params.getRawParameterValue("duckDepth");
+    duckAttackParam = params.getRawParameterValue("duckAttack");
+    duckReleaseParam = params.getRawParameterValue("duckRelease");
+
+    modIntervalParam = params.getRawParameterValue("modInterval");
+    lfo1RateParam = params.getRawParameterValue("lfo1Rate");
+    lfo1ShapeParam = params.getRawParameterValue("lfo1Shape");
+    lfo2RateParam = params.getRawParameterValue("lfo2Rate");
+    lfo2ShapeParam = params.getRawParameterValue("lfo2Shape");
+    randomRateParam = params.getRawParameterValue("randomRate");
+    for (int slot = 0; slot < numModRoutes; ++slot)
+    {
+      const auto prefix = "mod" + juce::String(slot + 1);
+      modSourceParams[static_cast<size_t>(slot)] = params.getRawParameterValue(prefix + "Source");
+      modTargetParams[static_cast<size_t>(slot)] = params.getRawParameterValue(prefix + "Target");
+      modDepthParams[static_cast<size_t>(slot)] = params.getRawParameterValue(prefix + "Depth");
+    }
+    for (size_t i = 0; i < numRandomised; ++i)
+    {
+      randomisedParams[i] = params.getRawParameterValue(randomisedParameterIds[i]);
+      randomisedParameters[i] = params.getParameter(randomisedParameterIds[i]);
+    }
+
+    if (updateEffects)
+      forEachRack([this](auto& r) { applyParameters(r); });
+}
+
+template <typename SampleType>
+void DerangerAudioProcessor::applyParameters(RackProcessor<SampleType>& target)
+{
+    target.setStretchSemitones(*stretchSemitonesParam);
+    target.setStretchEnabled(*stretchEnabledParam);
+    target.getRoot().setParallel(*isParallelParam);
+    target.setRandomize(*randomizeParam);
+    // The effects follow their parameters from syncModeParameters(), on the audio thread
+}
+
+// Mode switches have no dedicated UI control, they follow the host parameters directly
+void DerangerAudioProcessor::syncModeParameters()
+{
+    // Mode switches can change the rack's latency; the timer tells the host whenever it moves
+    rackLatency.store(withActiveRack([this](auto& r) {
+      syncModeParameters(r);
+      return r.getLatencySamples();
+    }));
+}
+
+// Called every block, so each setting is only pushed to the rack when its parameter has moved
+template <typename SampleType>
+void DerangerAudioProcessor::syncModeParameters(RackProcessor<SampleType>& target)
+{
+    auto& fx = handlesFor(target);
+
+    // Edits made while a finished morph waits to be reported are picked up once it has been
+    if (!morphResultPending.load())
+    {
+      for (size_t i = 0; i < numRandomised; ++i)
+        if (fx.randomised[i].update(*randomisedParams[i]))
+          setRandomised(fx, static_cast<Randomised>(i), fx.randomised[i].value);
+    }
+
+    using FeedbackMode = typename DelayProcessor<SampleType>::FeedbackMode;
+    if (fx.delayMode.update(*delayModeParam))
+      fx.delay->setFeedbackMode(static_cast<FeedbackMode>(static_cast<int>(fx.delayMode.value)));
+    if (fx.delayStereoAmount.update(*delayStereoAmountParam))
+      fx.delay->setStereoAmount(fx.delayStereoAmount.value);
+
+    using Engine = typename ReverbProcessor<SampleType>::Engine;
+    using Rate = typename ReverbProcessor<SampleType>::Rate;
+    if (fx.reverbEngine.update(*reverbEngineParam))
+      fx.reverb->setEngine(static_cast<Engine>(static_cast<int>(fx.reverbEngine.value)));
+    if (fx.reverbRate.update(*reverbRateParam))
+      fx.reverb->setRate(static_cast<Rate>(static_cast<int>(fx.reverbRate.value)));
+
+    if (fx.convolutionMix.update(*convolutionMixParam))
+      fx.convolution->setMix(fx.convolutionMix.value);
+
+    using Flanger = FlangerProcessor<SampleType>;
+    if (fx.flangerShape.update(*flangerShapeParam))
+      fx.flanger->setLFOShape(static_cast<typename Flanger::LFOShape>(static_cast<int>(fx.flangerShape.value)));
+    if (fx.flangerInterpolation.update(*flangerInterpolationParam))
+      fx.flanger->setInterpolation(static_cast<typename Flanger::Interpolation>(static_cast<int>(fx.flangerInterpolation.value)));
+    if (fx.flangerThroughZero.update(*flangerThroughZeroParam))
+      fx.flanger->setThroughZero(fx.flangerThroughZero.value > 0.5f);
+
+    if (fx.morphBeats.update(*morphBeatsParam))
+      target.setMorphBeats(fx.morphBeats.value);
+
+    // Builds in the background and crossfades; the latency moves once the fade is done
+    using StretchQuality = typename RackProcessor<SampleType>::StretchQuality;
+    if (fx.stretchQuality.update(*stretchQualityParam))
+      target.setStretchQuality(static_cast<StretchQuality>(static_cast<int>(fx.stretchQuality.value)));
+    if (fx.stretchLinked.update(*stretchLinkedParam))
+      target.setStretchLinked(fx.stretchLinked.value > 0.5f);
+    if (fx.stretchSplit.update(*stretchSplitParam))
+      target.setStretchSplitComputation(fx.stretchSplit.value > 0.5f);
+
+    // The time constants each cost an exp()
+    auto& ducker = target.getDucker();
+    if (fx.duckDepth.update(*duckDepthParam))
+      ducker.setDepth(fx.duckDepth.value);
+    if (fx.duckAttack.update(*duckAttackParam))
+      ducker.setAttackMs(fx.duckAttack.value);
+    if (fx.duckRelease.update(*duckReleaseParam))
+      ducker.setReleaseMs(fx.duckRelease.value);
+
+    using Matrix = ModulationMatrix<SampleType>;
+    auto& modulation = target.getModulation();
+    if (fx.modInterval.update(*modIntervalParam))
+      modulation.setControlInterval(16 << static_cast<int>(fx.modInterval.value));
+    // Bitwise or, so both halves of a pair are always brought up to date
+    if (fx.lfo1Rate.update(*lfo1RateParam) | fx.lfo1Shape.update(*lfo1ShapeParam))
+      modulation.setLFO(0, fx.lfo1Rate.value, static_cast<typename Matrix::LFOShape>(static_cast<int>(fx.lfo1Shape.value)));
+    if (fx.lfo2Rate.update(*lfo2RateParam) | fx.lfo2Shape.update(*lfo2ShapeParam))
+      modulation.setLFO(1, fx.lfo2Rate.value, static_cast<typename Matrix::LFOShape>(static_cast<int>(fx.lfo2Shape.value)));
+    if (fx.randomRate.update(*randomRateParam))
+      modulation.setRandomRate(fx.randomRate.value);
+
+    for (int slot = 0; slot < numModRoutes; ++slot)
+    {
+      const auto index = static_cast<size_t>(slot);
+      auto& source = fx.modSource[index];
+      auto& destination = fx.modTarget[index];
+      auto& depth = fx.modDepth[index];
+      if (source.update(*modSourceParams[index]) | destination.update(*modTargetParams[index]) | depth.update(*modDepthParams[index]))
+        modulation.setRoute(slot,
+                            static_cast<typename Matrix::Source>(static_cast<int>(source.value)),
+                            static_cast<typename Matrix::Destination>(static_cast<int>(destination.value)),
+                            depth.value);
+    }
+}
+
+template <typename SampleType>
+float DerangerAudioProcessor::getRandomised(RackHandles<SampleType>& fx, Randomised which)
+{
+    switch (which)
+    {
+      case Randomised::roomSize:        return fx.reverb->getParameters().roomSize;
+      case Randomised::damping:         return fx.reverb->getParameters().damping;
+      case Randomised::wetLevel:        return fx.reverb->getParameters().wetLevel;
+      case Randomised::delayTime:       return static_cast<float>(fx.delay->getTargetDelayTime() / _sampleRate);
+      case Randomised::delayFeedback:   return static_cast<float>(fx.delay->getFeedback());
+      case Randomised::flangerDelay:    return static_cast<float>(fx.flanger->getDelay());
+      case Randomised::flangerDepth:    return static_cast<float>(fx.flanger->getLFODepth());
+      case Randomised::flangerFeedback: return static_cast<float>(fx.flanger->getFeedback());
+    }
+    return 0.0f;
+}
+
+template <typename SampleType>
+void DerangerAudioProcessor::setRandomised(RackHandles<SampleType>& fx, Randomised which, float value)
+{
+    using Reverb = ReverbProcessor<SampleType>;
+    using Delay = DelayProcessor<SampleType>;
+    using Flanger = FlangerProcessor<SampleType>;
+
+    const auto setReverb = [&](float juce::Reverb::Parameters::* field, int morphIndex) {
+      auto params = fx.reverb->getParameters();
+      params.*field = value;
+      fx.reverb->setParameters(params);
+      fx.reverb->holdMorphParameter(morphIndex, static_cast<SampleType>(value));
+    };
+
+    switch (which)
+    {
+      case Randomised::roomSize: setReverb(&juce::Reverb::Parameters::roomSize, Reverb::morphRoomSize); break;
+      case Randomised::damping:  setReverb(&juce::Reverb::Parameters::damping, Reverb::morphDamping); break;
+      case Randomised::wetLevel: setReverb(&juce::Reverb::Parameters::wetLevel, Reverb::morphWetLevel); break;
+      case Randomised::delayTime:
+      {
+        const auto samples = value * static_cast<float>(_sampleRate);
+        fx.delay->setDelayTime(samples);
+        fx.delay->holdMorphParameter(Delay::morphDelayTime, static_cast<SampleType>(samples));
+        break;
+      }
+      case Randomised::delayFeedback:
+        fx.delay->setFeedback(value);
+        fx.delay->holdMorphParameter(Delay::morphFeedback, static_cast<SampleType>(value));
+        break;
+      case Randomised::flangerDelay:
+        fx.flanger->setDelay(value);
+        fx.flanger->holdMorphParameter(Flanger::morphCentreDelay, static_cast<SampleType>(value));
+        break;
+      case Randomised::flangerDepth:
+        fx.flanger->setLFODepth(value);
+        fx.flanger->holdMorphParameter(Flanger::morphDepth, static_cast<SampleType>(value));
+        break;
+      case Randomised::flangerFeedback:
+        fx.flanger->setFeedback(value);
+        fx.flanger->holdMorphParameter(Flanger::morphFeedback, static_cast<SampleType>(value));
+        break;
+    }
+}
 
-    if (updateEffects) {
-      rack.setStretchSemitones(*stretchSemitonesParam);
-      rack.setStretchEnabled(*stretchEnabledParam);
-      rack.getRoot().setParallel(*isParallelParam);
-      rack.setRandomize(*randomizeParam);
+// Audio thread, once a morph has reached what the randomiser drew
+template <typename SampleType>
+void DerangerAudioProcessor::publishMorphResult(RackProcessor<SampleType>& target)
+{
+    auto& fx = handlesFor(target);
+    for (size_t i = 0; i < numRandomised; ++i)
+    {
+      // As the parameter will hold it after the round trip, so it doesn't come back as an edit
+      const auto* param = randomisedParameters[i];
+      const auto value = param->convertFrom0to1(param->convertTo0to1(getRandomised(fx, static_cast<Randomised>(i))));
+      morphResult[i].store(value);
+      morphResultBase[i].store(*randomisedParams[i]);
+      fx.randomised[i].value = value;
+    }
+    morphResultPending.store(true);
+}
 
-      dynamic_cast<DelayProcessor*>(rack.findProcessor("Delay"))->setDelayTime(*delayTimeParam * (float)_sampleRate);
-      dynamic_cast<DelayProcessor*>(rack.findProcessor("Delay"))->setFeedback(*delayFeedbackParam);
+// Hosts expect latency changes on the message thread, so the audio thread only publishes it
+void DerangerAudioProcessor::timerCallback()
+{
+    const int latency = rackLatency.load();
+    if (latency != getLatencySamples())
+      setLatencySamples(latency);
 
-      auto params = dynamic_cast<ReverbProcessor*>(rack.findProcessor("Reverb"))->getParameters();
-      params.roomSize = *roomSizeParam;
-      params.damping = *dampingParam;
-      params.wetLevel = *wetLevelParam;
-      dynamic_cast<ReverbProcessor*>(rack.findProcessor("Reverb"))->setParameters(params);
+    if (morphResultPending.load())
+    {
+      // A parameter edited since the morph finished keeps the edit
+      for (size_t i = 0; i < numRandomised; ++i)
+      {
+        auto* param = randomisedParameters[i];
+        if (randomisedParams[i]->load() == morphResultBase[i].load())
+          param->setValueNotifyingHost(param->convertTo0to1(morphResult[i].load()));
+      }
+      morphResultPending.store(false);
 
-      dynamic_cast<FlangerProcessor*>(rack.findProcessor("Flanger"))->setFeedback(*flangerFeedbackParam);
-      dynamic_cast<FlangerProcessor*>(rack.findProcessor("Flanger"))->setDelay(*flangerDelayParam);
-      dynamic_cast<FlangerProcessor*>(rack.findProcessor("Flanger"))->setLFODepth(*flangerDepthParam);
+      if (onStateChanged)
+        onStateChanged();
     }
 }
 
+bool DerangerAudioProcessor::loadImpulseResponse(const juce::File& file)
+{
+    // The idle rack only builds its kernel once it is prepared
+    bool loaded = true;
+    forEachRack([&](auto& r) {
+      loaded = loaded && handlesFor(r).convolution->loadImpulseResponse(file);
+    });
+
+    if (!loaded)
+      return false;
+
+    // Kept in the state so a session reopens with the same response
+    parameters.state.setProperty("impulseResponse", file.getFullPathName(), nullptr);
+    return true;
+}
+
 void DerangerAudioProcessor::applyEffectParamChanges(const std::map<std::string, float>& paramMap) const
 {
     for (const auto& [id, value] : paramMap)
     {
-        juce::Identifier paramId(id);
-        if (auto* param = dynamic_cast<juce::AudioParameterFloat*>(parameters.getParameter(id)))
+        // Hosts take normalised values
+        if (auto* param = parameters.getParameter(id))
         {
-            param->setValueNotifyingHost(value);
-        } else if (auto* param = dynamic_cast<juce::AudioParameterBool*>(parameters.getParameter(id)))
-        {
-            param->setValueNotifyingHost(value);
+            param->setValueNotifyingHost(param->convertTo0to1(value));
         } else {
-            printf("!! WARNING: Param '%s' not found or not float/bool!\n", id.c_str());
+            printf("!! WARNING: Param '%s' not found!\n", id.c_str());
         }
     }
 }
 
 void DerangerAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-  for (auto param : parameters.state) // TODO (amp1ee): remove this w/a:
-  {
-      auto param_name = param.getProperty("id").toString().toRawUTF8();
-      if (std::strcmp(param_name, "delayTime") == 0)
-        param.setProperty("value", dynamic_cast<DelayProcessor*>(rack.findProcessor("Delay"))->getTargetDelayTime()/_sampleRate, nullptr);
-      else if (std::strcmp(param_name, "flangerDelay") == 0)
-        param.setProperty("value", dynamic_cast<FlangerProcessor*>(rack.findProcessor("Flanger"))->getDelay(), nullptr);
-      else if (std::strcmp(param_name, "stretchSemitones") == 0)
-        param.setProperty("value", rack.getStretchSemitones(), nullptr);
-  }
-
   // Saving the state to XML
-  std::unique_ptr<juce::XmlElement> xml (parameters.state.createXml());
+  std::unique_ptr<juce::XmlElement> xml (parameters.copyState().createXml());
   copyXmlToBinary (*xml, destData);
 }
 
@@ -132,6 +438,10 @@ void DerangerAudioProcessor::setStateInformation(const void* data, int sizeInByt
             onStateChanged();
         }
         initializeParameters(parameters, true);
+
+        const auto impulsePath = parameters.state.getProperty("impulseResponse").toString();
+        if (impulsePath.isNotEmpty())
+            loadImpulseResponse(juce::File(impulsePath));
     }
   }
 }
@@ -196,17 +506,36 @@ void DerangerAudioProcessor::prepareToPlay(double sampleRate,
   spec.maximumBlockSize = samplesPerBlock;
   spec.numChannels = getTotalNumOutputChannels();
 
+  // A rack coming into use picks up the host parameters; the other one's settings may have drifted
+  if (isUsingDoublePrecision() != doubleRackActive) {
+    doubleRackActive = isUsingDoublePrecision();
+    withActiveRack([this](auto& r) { applyParameters(r); });
+  }
+
+  // The delay time goes to the rack in samples, so it is pushed again at the new rate
+  withActiveRack([this](auto& r) { handlesFor(r).randomised[static_cast<size_t>(Randomised::delayTime)] = {}; });
+
   // Prepare the RackProcessor (this prepares all modules in the rack)
-  rack.prepare(spec);
+  syncModeParameters();
+  withActiveRack([this, &spec](auto& r) {
+    // The worker is only started or stopped here
+    r.setStretchAsync(stretchAsyncParam->load() > 0.5f);
+    r.prepare(spec);
+  });
+  rackLatency.store(withActiveRack([](auto& r) { return r.getLatencySamples(); }));
+  setLatencySamples(rackLatency.load());
 
 }
 
 void DerangerAudioProcessor::releaseResources() {
   // When playback stops, you can use this as an opportunity to free up any
   // spare memory, etc.
-  rack.reset();
+  // The stretch worker isn't restarted until the next prepareToPlay()
+  withActiveRack([](auto& r) { r.release(); });
 }
 
+bool DerangerAudioProcessor::supportsDoublePrecisionProcessing() const { return true; }
+
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool DerangerAudioProcessor::isBusesLayoutSupported(
     const BusesLayout &layouts) const {
@@ -226,6 +555,15 @@ bool DerangerAudioProcessor::isBusesLayoutSupported(
   if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet()) {
     return false;
 }
+
+  // The sidechain can be left disconnected, or carry mono or stereo
+  if (layouts.inputBuses.size() > 1) {
+    const auto sidechain = layouts.getChannelSet(true, 1);
+    if (!sidechain.isDisabled() && sidechain != juce::AudioChannelSet::mono() &&
+        sidechain != juce::AudioChannelSet::stereo()) {
+      return false;
+    }
+  }
 #endif
 
   return true;
@@ -235,9 +573,27 @@ bool DerangerAudioProcessor::isBusesLayoutSupported(
 
 void DerangerAudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
                                             juce::MidiBuffer & /*midiMessages*/) {
+  process(buffer, rack);
+}
+
+// The host's 64-bit mix stays 64-bit through the rack, with no conversion passes
+void DerangerAudioProcessor::processBlock(juce::AudioBuffer<double> &buffer,
+                                            juce::MidiBuffer & /*midiMessages*/) {
+  jassert(isUsingDoublePrecision());
+  process(buffer, doubleRack);
+}
+
+template <typename SampleType>
+void DerangerAudioProcessor::process(juce::AudioBuffer<SampleType> &hostBuffer,
+                                     RackProcessor<SampleType> &target) {
   juce::ScopedNoDenormals noDenormals;
-  auto totalNumInputChannels = getTotalNumInputChannels();
-  auto totalNumOutputChannels = getTotalNumOutputChannels();
+
+  // The host buffer also carries the sidechain's channels; everything else sees the main bus
+  auto buffer = getBusBuffer(hostBuffer, false, 0);
+  const auto sidechainBuffer = getBusCount(true) > 1 ? getBusBuffer(hostBuffer, true, 1)
+                                                     : juce::AudioBuffer<SampleType>();
+  auto totalNumInputChannels = getMainBusNumInputChannels();
+  auto totalNumOutputChannels = getMainBusNumOutputChannels();
 
   // Clear any unused output channels (same as in your current code)
   for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i) {
@@ -256,18 +612,23 @@ void DerangerAudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
             if (nowBpm != currentBPM)
             {
               currentBPM = nowBpm;
-              rack.setBPM(currentBPM);
+              target.setBPM(currentBPM);
             }
           }
         }
     }
   }
 
+  syncModeParameters();
+
   // Create AudioBlock from the AudioBuffer for processing
-  juce::dsp::AudioBlock<float> block(buffer);
+  juce::dsp::AudioBlock<SampleType> block(buffer);
+  const juce::dsp::AudioBlock<const SampleType> sidechain(sidechainBuffer);
 
   // Process the block with the RackProcessor
-  rack.process(block);
+  target.process(block, sidechain);
+  if (target.hasMorphFinished())
+    publishMorphResult(target);
 
   auto numSamples = buffer.getNumSamples();
   sum = 0.0f;
@@ -275,12 +636,12 @@ void DerangerAudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
   {
       auto* data = buffer.getReadPointer(ch);
       for (int i = 0; i < numSamples; ++i)
-          sum += data[i] * data[i];
+          sum += static_cast<float>(data[i] * data[i]);
   }
 
   rms = std::sqrt(sum / (numSamples * totalNumOutputChannels));
   currentRMSLevel.store(rms);
-  currentInstantLevel.store(buffer.getMagnitude(0, numSamples));
+  currentInstantLevel.store(static_cast<float>(buffer.getMagnitude(0, numSamples)));
 
   if (buffer.getNumChannels() >= 2)
   {
@@ -290,8 +651,8 @@ void DerangerAudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
 
       for (int i = 0; i < numSamples; ++i)
       {
-          leftPeak  = std::max(leftPeak,  std::abs(left[i]));
-          rightPeak = std::max(rightPeak, std::abs(right[i]));
+          leftPeak  = std::max(leftPeak,  static_cast<float>(std::abs(left[i])));
+          rightPeak = std::max(rightPeak, static_cast<float>(std::abs(right[i])));
       }
 
       float width = std::abs(leftPeak - rightPeak);
@@ -308,8 +669,6 @@ juce::AudioProcessorEditor *DerangerAudioProcessor::createEditor() {
   return new DerangerAudioProcessorEditor(*this);
 }
 
-RackProcessor& DerangerAudioProcessor::getRack() { return this->rack; }
-
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor *JUCE_CALLTYPE createPluginFilter() {
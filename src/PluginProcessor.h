@@ -2,12 +2,14 @@
 
 #include <JuceHeader.h>
 #include <atomic>
+#include <limits>
 #include "core/RackProcessor.h"
 
 //==============================================================================
 /**
  */
-class DerangerAudioProcessor : public juce::AudioProcessor {
+class DerangerAudioProcessor : public juce::AudioProcessor,
+                               private juce::Timer {
 
  public:
   //==============================================================================
@@ -23,6 +25,8 @@ class DerangerAudioProcessor : public juce::AudioProcessor {
 #endif
 
   void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
+  void processBlock(juce::AudioBuffer<double> &, juce::MidiBuffer &) override;
+  bool supportsDoublePrecisionProcessing() const override;
 
   //==============================================================================
   juce::AudioProcessorEditor *createEditor() override;
@@ -47,32 +51,152 @@ class DerangerAudioProcessor : public juce::AudioProcessor {
   void getStateInformation(juce::MemoryBlock &destData) override;
   void setStateInformation(const void *data, int sizeInBytes) override;
 
-  RackProcessor& getRack();
+  // Edits go to both racks, so the idle one is current if the host switches precision
+  template <typename Fn>
+  void forEachRack(Fn&& fn) { fn(rack); fn(doubleRack); }
+
+  template <typename Fn>
+  decltype(auto) withActiveRack(Fn&& fn) { return isUsingDoublePrecision() ? fn(doubleRack) : fn(rack); }
+
+  // e.g. forEachEffect<DelayProcessor>("Delay", [](auto& delay) { ... })
+  template <template <typename> class Effect, typename Fn>
+  void forEachEffect(const juce::String& name, Fn&& fn)
+  {
+    forEachRack([&](auto& r) {
+      if (auto* effect = r.template findEffect<Effect>(name))
+        fn(*effect);
+    });
+  }
+
   float getCurrentBPM() const { return currentBPM; }
   float getRMSLevel() const { return currentRMSLevel.load(); }
   float getInstantLevel() const { return currentInstantLevel.load(); }
   float getStereoWidth() const { return currentStereoWidth.load(); }
 
+  // For the editor: the pitch shifter's cost per block, and what the async worker failed to deliver
+  const BlockCostHistogram& getStretchCost() { return withActiveRack([](auto& r) -> const BlockCostHistogram& { return r.getStretchCost(); }); }
+  juce::uint32 getStretchUnderrunSamples() { return withActiveRack([](auto& r) { return r.getStretchUnderrunSamples(); }); }
+  // The worker setting from the last prepareToPlay(); the parameter only reaches the rack on the next one
+  bool getStretchAsyncInUse() { return withActiveRack([](auto& r) { return r.getStretchAsync(); }); }
+
   juce::AudioProcessorValueTreeState parameters;
   std::function<void()> onStateChanged;
   void initializeParameters(juce::AudioProcessorValueTreeState& params, bool updateEffects = false);
   void applyEffectParamChanges(const std::map<std::string, float>& paramMap) const;
+  void syncModeParameters();
+  bool loadImpulseResponse(const juce::File& file);
 
   std::atomic<float>*randomizeParam;
   std::atomic<float>*stretchEnabledParam;
   std::atomic<float>*stretchSemitonesParam;
+  std::atomic<float>*stretchSplitParam;
+  std::atomic<float>*stretchAsyncParam;
+  std::atomic<float>*stretchQualityParam;
+  std::atomic<float>*stretchLinkedParam;
   std::atomic<float>*isParallelParam;
   std::atomic<float>*delayTimeParam;
   std::atomic<float>*delayFeedbackParam;
+  std::atomic<float>*delayModeParam;
+  std::atomic<float>*delayStereoAmountParam;
   std::atomic<float>*roomSizeParam;
   std::atomic<float>*wetLevelParam;
   std::atomic<float>*dampingParam;
+  std::atomic<float>*reverbEngineParam;
+  std::atomic<float>*reverbRateParam;
+  std::atomic<float>*convolutionMixParam;
   std::atomic<float>*flangerFeedbackParam;
   std::atomic<float>*flangerDelayParam;
   std::atomic<float>*flangerDepthParam;
+  std::atomic<float>*flangerShapeParam;
+  std::atomic<float>*flangerInterpolationParam;
+  std::atomic<float>*flangerThroughZeroParam;
+  std::atomic<float>*morphBeatsParam;
+  std::atomic<float>*duckDepthParam;
+  std::atomic<float>*duckAttackParam;
+  std::atomic<float>*duckReleaseParam;
+  std::atomic<float>*modIntervalParam;
+  std::atomic<float>*lfo1RateParam;
+  std::atomic<float>*lfo1ShapeParam;
+  std::atomic<float>*lfo2RateParam;
+  std::atomic<float>*lfo2ShapeParam;
+  std::atomic<float>*randomRateParam;
+
+  static constexpr int numModRoutes = ModulationMatrix<float>::maxRoutes;
+  std::array<std::atomic<float>*, numModRoutes> modSourceParams;
+  std::array<std::atomic<float>*, numModRoutes> modTargetParams;
+  std::array<std::atomic<float>*, numModRoutes> modDepthParams;
 
  private:
-  RackProcessor rack;
+  // What the randomiser draws, in the order of randomisedParameterIds in the .cpp
+  enum class Randomised { roomSize, damping, wetLevel, delayTime, delayFeedback, flangerDelay, flangerDepth, flangerFeedback };
+  static constexpr size_t numRandomised = 8;
+
+  // A raw parameter value as last handed to a rack, so settings are only pushed when they move
+  struct SyncedValue
+  {
+    float value = std::numeric_limits<float>::quiet_NaN();
+
+    // True the first time, and whenever the parameter has changed since
+    bool update(const std::atomic<float>& param)
+    {
+      const auto now = param.load();
+      if (now == value)
+        return false;
+      value = now;
+      return true;
+    }
+  };
+
+  // A rack's effects, looked up once in buildRack(), and the mode settings it was last given
+  template <typename SampleType>
+  struct RackHandles
+  {
+    DelayProcessor<SampleType>* delay = nullptr;
+    ReverbProcessor<SampleType>* reverb = nullptr;
+    FlangerProcessor<SampleType>* flanger = nullptr;
+    ConvolutionReverbProcessor<SampleType>* convolution = nullptr;
+
+    SyncedValue delayMode, delayStereoAmount, reverbEngine, reverbRate, convolutionMix;
+    SyncedValue flangerShape, flangerInterpolation, flangerThroughZero, morphBeats;
+    SyncedValue stretchQuality, stretchLinked, stretchSplit, duckDepth, duckAttack, duckRelease;
+    SyncedValue modInterval, lfo1Rate, lfo1Shape, lfo2Rate, lfo2Shape, randomRate;
+    std::array<SyncedValue, numModRoutes> modSource, modTarget, modDepth;
+    std::array<SyncedValue, numRandomised> randomised;
+  };
+
+  RackHandles<float>& handlesFor(RackProcessor<float>&) { return handles; }
+  RackHandles<double>& handlesFor(RackProcessor<double>&) { return doubleHandles; }
+
+  void timerCallback() override;
+
+  // In the parameters' units; setting one also keeps a running morph off it
+  template <typename SampleType> float getRandomised(RackHandles<SampleType>& fx, Randomised which);
+  template <typename SampleType> void setRandomised(RackHandles<SampleType>& fx, Randomised which, float value);
+  template <typename SampleType> void publishMorphResult(RackProcessor<SampleType>& target);
+
+  template <typename SampleType> void buildRack(RackProcessor<SampleType>& target);
+  template <typename SampleType> void applyParameters(RackProcessor<SampleType>& target);
+  template <typename SampleType> void syncModeParameters(RackProcessor<SampleType>& target);
+  template <typename SampleType> void process(juce::AudioBuffer<SampleType>& buffer, RackProcessor<SampleType>& target);
+
+  // Only the rack matching the host's processing precision is prepared and run
+  RackProcessor<float> rack;
+  RackProcessor<double> doubleRack;
+  bool doubleRackActive = false;
+  RackHandles<float> handles;
+  RackHandles<double> doubleHandles;
+
+  // Set by the audio thread; the timer passes it on to the host from the message thread
+  std::atomic<int> rackLatency = 0;
+
+  std::array<std::atomic<float>*, numRandomised> randomisedParams {};
+  std::array<juce::RangedAudioParameter*, numRandomised> randomisedParameters {};
+
+  // Where a finished morph left the randomised parameters, and what the host had for them
+  // then; the timer hands the result over unless a parameter has been edited since
+  std::array<std::atomic<float>, numRandomised> morphResult {};
+  std::array<std::atomic<float>, numRandomised> morphResultBase {};
+  std::atomic<bool> morphResultPending = false;
 
   // BPM Sync
   std::atomic<float> currentBPM = 0.0f;
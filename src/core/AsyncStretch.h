@@ -0,0 +1,214 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BlockCostHistogram.h"
+#include "StretchStage.h"
+
+/**
+*   Runs the pitch shifter on a worker thread, one block behind the audio thread.
+*
+*   Each block, the audio thread pushes its input into one lock-free ring, wakes the
+*   worker and pulls the same number of samples from a second ring, which starts out
+*   holding one maximum-size block of silence. The worker drains the input ring through
+*   the stretch into the output ring. As long as it finishes a block before the next one
+*   is due, the audio thread always finds enough output, and the stretch's FFT spikes
+*   never land in the host's callback. The cost is one maximum block of latency.
+*
+*   If the worker falls behind, the missing output is played as silence and the same
+*   amount is skipped once the worker catches up, so the latency stays put.
+*
+*   The stretch belongs to the worker while it runs: configuring and resetting it go
+*   through here. Transposing and quality changes are safe from any thread anyway.
+*/
+template <typename SampleType>
+class AsyncStretch : private juce::Thread
+{
+public:
+    using Stretch = StretchStage<SampleType>;
+
+    AsyncStretch(Stretch& s, BlockCostHistogram& cost)
+        : juce::Thread("Deranger stretch"), stretch(s), stretchCost(cost) {}
+
+    ~AsyncStretch() override { stop(); }
+
+    /** Message thread. Sizes the rings, primes the output and starts the worker. */
+    void prepare(int numChannels, int maximumBlockSize, double rate)
+    {
+        stop();
+
+        sampleRate = rate;
+        maxBlock = juce::jmax(1, maximumBlockSize);
+
+        // Room for a few blocks each way before either side has to drop anything
+        const int capacity = 4 * maxBlock + 1;
+        for (auto* ring : { &input, &output })
+        {
+            ring->buffer.setSize(numChannels, capacity, false, true, false);
+            ring->fifo.setTotalSize(capacity);
+        }
+        scratch.setSize(numChannels, maxBlock, false, true, false);
+        scratchPointers.resize(static_cast<size_t>(numChannels));
+
+        prime();
+        startThread(juce::Thread::Priority::highest);
+    }
+
+    /** Message thread. Stops the worker; the stretch can be touched directly afterwards. */
+    void stop()
+    {
+        stopThread(1000);
+    }
+
+    [[nodiscard]] bool isRunning() const { return isThreadRunning(); }
+
+    /** Message thread, with the audio stopped. Clears the stretch and the rings, keeping the worker. */
+    void reset()
+    {
+        const bool wasRunning = isRunning();
+        stop();
+        stretch.reset();
+        prime();
+        if (wasRunning)
+            startThread(juce::Thread::Priority::highest);
+    }
+
+    // The output ring's head start
+    [[nodiscard]] int getLatencySamples() const { return maxBlock; }
+
+    // Samples played as silence because the worker hadn't produced them in time
+    [[nodiscard]] juce::uint32 getUnderrunSamples() const { return underrunSamples.load(std::memory_order_relaxed); }
+
+    /** Audio thread. Replaces the block with the output from one maximum block ago. Never blocks. */
+    void process(juce::dsp::AudioBlock<SampleType>& block)
+    {
+        const int numSamples = static_cast<int>(block.getNumSamples());
+
+        // If the input ring is full the worker is far behind; what doesn't fit is lost either way
+        write(input, block, numSamples);
+        notify();
+
+        // Catch up on output that was owed as silence, but never at this block's expense
+        if (owed > 0)
+        {
+            const int skip = juce::jmin(owed, output.fifo.getNumReady() - numSamples);
+            if (skip > 0)
+            {
+                output.fifo.finishedRead(skip);
+                owed -= skip;
+            }
+        }
+
+        const int got = read(output, block, numSamples);
+        if (got < numSamples)
+        {
+            block.getSubBlock(static_cast<size_t>(got)).clear();
+            owed += numSamples - got;
+            underrunSamples.fetch_add(static_cast<juce::uint32>(numSamples - got), std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Ring
+    {
+        juce::AudioBuffer<SampleType> buffer;
+        juce::AbstractFifo fifo { 1 };
+    };
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            const int ready = input.fifo.getNumReady();
+            if (ready == 0)
+            {
+                wait(10);
+                continue;
+            }
+
+            const int chunk = juce::jmin(ready, maxBlock);
+            readInto(input, scratch, chunk);
+
+            for (size_t ch = 0; ch < scratchPointers.size(); ++ch)
+                scratchPointers[ch] = scratch.getWritePointer(static_cast<int>(ch));
+
+            // In place: the stretch keeps its own copy of the input
+            {
+                BlockCostHistogram::ScopedTimer timer(stretchCost, chunk, sampleRate);
+                stretch.process(scratchPointers.data(), scratchPointers.data(), chunk);
+            }
+
+            // The audio thread reads as fast as it writes, so this only overflows after a reset race
+            writeFrom(output, scratch, chunk);
+        }
+    }
+
+    // Message thread, worker stopped
+    void prime()
+    {
+        for (auto* ring : { &input, &output })
+        {
+            ring->buffer.clear();
+            ring->fifo.reset();
+        }
+        output.fifo.finishedWrite(maxBlock);
+        owed = 0;
+    }
+
+    template <typename Source>
+    static void copyIn(Ring& ring, int ringStart, const Source& source, int sourceStart, int count)
+    {
+        for (int ch = 0; ch < ring.buffer.getNumChannels(); ++ch)
+            juce::FloatVectorOperations::copy(ring.buffer.getWritePointer(ch, ringStart),
+                                              source.getChannelPointer(static_cast<size_t>(ch)) + sourceStart, count);
+    }
+
+    static int write(Ring& ring, const juce::dsp::AudioBlock<SampleType>& block, int numSamples)
+    {
+        int start1, size1, start2, size2;
+        ring.fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+        copyIn(ring, start1, block, 0, size1);
+        copyIn(ring, start2, block, size1, size2);
+        ring.fifo.finishedWrite(size1 + size2);
+        return size1 + size2;
+    }
+
+    static int read(Ring& ring, juce::dsp::AudioBlock<SampleType>& block, int numSamples)
+    {
+        int start1, size1, start2, size2;
+        ring.fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+        for (int ch = 0; ch < ring.buffer.getNumChannels(); ++ch)
+        {
+            auto* dest = block.getChannelPointer(static_cast<size_t>(ch));
+            juce::FloatVectorOperations::copy(dest, ring.buffer.getReadPointer(ch, start1), size1);
+            juce::FloatVectorOperations::copy(dest + size1, ring.buffer.getReadPointer(ch, start2), size2);
+        }
+        ring.fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+    static void readInto(Ring& ring, juce::AudioBuffer<SampleType>& dest, int numSamples)
+    {
+        juce::dsp::AudioBlock<SampleType> block(dest);
+        read(ring, block, numSamples);
+    }
+
+    static void writeFrom(Ring& ring, juce::AudioBuffer<SampleType>& source, int numSamples)
+    {
+        write(ring, juce::dsp::AudioBlock<SampleType>(source), numSamples);
+    }
+
+    Stretch& stretch;
+    BlockCostHistogram& stretchCost;
+
+    Ring input, output;
+    juce::AudioBuffer<SampleType> scratch;     // worker only
+    std::vector<SampleType*> scratchPointers; // worker only
+
+    double sampleRate = 44100.0;
+    int maxBlock = 1;
+    int owed = 0; // audio thread only
+
+    std::atomic<juce::uint32> underrunSamples { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(AsyncStretch)
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+*   How long a processing stage takes per block, as a share of the block's real-time
+*   budget (its length in seconds), counted in octave-wide bins:
+*
+*       bin 0            under 1/1024 of the budget
+*       bin k            1/2^(11-k) up to 1/2^(10-k)
+*       last bin         the whole budget or more
+*
+*   The audio thread records; counts are relaxed atomics, so the message thread can read
+*   them at any time, for a debug dump or a meter. The peak says more about the buffer
+*   size a stage can run at than the average does.
+*/
+class BlockCostHistogram
+{
+public:
+    static constexpr int numBins = 12;
+
+    // Audio thread. Times the enclosing scope against a block of numSamples.
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(BlockCostHistogram& h, int numSamples, double rate)
+            : histogram(h), budgetSeconds(numSamples / rate), start(juce::Time::getHighResolutionTicks()) {}
+
+        ~ScopedTimer()
+        {
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            histogram.record(elapsed / budgetSeconds);
+        }
+
+    private:
+        BlockCostHistogram& histogram;
+        double budgetSeconds;
+        juce::int64 start;
+    };
+
+    void record(double budgetFraction)
+    {
+        const auto octaves = budgetFraction > 0.0 ? std::floor(std::log2(budgetFraction)) : -100.0;
+        const auto bin = juce::jlimit(0, numBins - 1, static_cast<int>(octaves) + numBins - 1);
+        counts[static_cast<size_t>(bin)].fetch_add(1, std::memory_order_relaxed);
+
+        if (budgetFraction > peak.load(std::memory_order_relaxed))
+            peak.store(static_cast<float>(budgetFraction), std::memory_order_relaxed);
+    }
+
+    // Message thread. Counts recorded meanwhile may land either side of the reset.
+    void reset()
+    {
+        for (auto& count : counts)
+            count.store(0, std::memory_order_relaxed);
+        peak.store(0.0f, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] juce::uint32 getCount(int bin) const { return counts[static_cast<size_t>(bin)].load(std::memory_order_relaxed); }
+
+    // Upper edge of a bin as a share of the budget; the last bin has none
+    static double getBinLimit(int bin) { return std::ldexp(1.0, bin - (numBins - 2)); }
+
+    [[nodiscard]] float getPeak() const { return peak.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] juce::String toString() const
+    {
+        juce::String text;
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            text << (bin == numBins - 1 ? juce::String(">= 1") : "< " + juce::String(getBinLimit(bin), 4))
+                 << ": " << juce::String(getCount(bin)) << "\n";
+        }
+        return text << "peak " << juce::String(getPeak(), 3) << " of the block";
+    }
+
+private:
+    std::array<std::atomic<juce::uint32>, numBins> counts {};
+    std::atomic<float> peak { 0.0f };
+};
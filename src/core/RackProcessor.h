@@ -1,14 +1,18 @@
 #pragma once
 
 #include <juce_dsp/juce_dsp.h>
-#include <signalsmith-stretch.h>
 #include "../effects/ReverbProcessor.h"
 #include "../effects/DelayProcessor.h"
 #include "../effects/FlangerProcessor.h"
+#include "../effects/ConvolutionReverbProcessor.h"
 #include "RoutingNode.h"
+#include "BlockCostHistogram.h"
+#include "StretchStage.h"
+#include "AsyncStretch.h"
 
 using juce::Reverb;
 
+template <typename SampleType>
 class RackProcessor
 {
     public:
@@ -16,18 +20,51 @@ class RackProcessor
         void prepare(const juce::dsp::ProcessSpec &spec)
         {
             _sampleRate = static_cast<float>(spec.sampleRate);
+
+            // Effects register their modulated parameters during prepare, as they do delay lines
+            modulation.prepare(spec);
+
+            // Delay lines register during prepare and are bound once the layout is known
+            delayArena.beginLayout(spec.sampleRate);
+            morph.beginLayout();
             root.prepare(spec);
-            stretch.presetDefault(static_cast<int>(spec.numChannels),
-                                 static_cast<float>(spec.sampleRate));
+            morph.endLayout();
+            delayArena.endLayout();
+
+            ducker.prepare(spec);
+
+            // The worker owns the stretch while it runs, so it stops before reconfiguring
+            asyncStretch.stop();
             stretch.setTransposeSemitones(stretchSemitones);
-            limiter.setThreshold(-4.0f);
+            stretch.prepare(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize), spec.sampleRate);
+            channelPointers.resize(spec.numChannels);
+            if (stretchAsync)
+                asyncStretch.prepare(static_cast<int>(spec.numChannels),
+                                     static_cast<int>(spec.maximumBlockSize), spec.sampleRate);
+            limiter.setThreshold(static_cast<SampleType>(-4));
             limiter.prepare(spec);
         }
 
-        void process(juce::dsp::AudioBlock<float> &block)
+        // The sidechain has no channels when the host hasn't connected one
+        void process(juce::dsp::AudioBlock<SampleType> &block,
+                     const juce::dsp::AudioBlock<const SampleType>& sidechain = {})
         {
-            if (stretchEnabled)
+            ducker.process(sidechain, static_cast<int>(block.getNumSamples()));
+
+            // The async worker times its own chunks
+            if (stretchEnabled && asyncStretch.isRunning())
+            {
+                asyncStretch.process(block);
+            }
+            else if (stretchEnabled)
+            {
+                BlockCostHistogram::ScopedTimer timer(stretchCost, static_cast<int>(block.getNumSamples()), _sampleRate);
                 stretchBlock(block);
+            }
+
+            // Sources follow what the effects are about to hear
+            modulation.process(block, sidechain, static_cast<int>(block.getNumSamples()));
+            morph.advance(static_cast<int>(block.getNumSamples()));
 
             // Process the audio block through the routing tree
             root.process(block);
@@ -43,22 +80,40 @@ class RackProcessor
             // Assuming 512-sample buffer @ 44100 Hz → ~11.6 ms per block
             if (toRandomize && (blockCounter % blocksPerUpdate) == 0) {
                 root.updateRandomly(currentBPM);
+                morph.start(getMorphSamples());
             }
 
-            limiter.process(juce::dsp::ProcessContextReplacing<float>(block));
+            limiter.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
             blockCounter++;
         }
 
         void reset()
         {
             root.reset();
-            stretch.reset();
+            ducker.reset();
+            modulation.reset();
+            morph.reset();
+            if (asyncStretch.isRunning())
+                asyncStretch.reset();
+            else
+                stretch.reset();
             limiter.reset();
         }
 
+        // Message thread, once playback has stopped: the stretch worker stays stopped until prepare()
+        void release()
+        {
+            asyncStretch.stop();
+            reset();
+        }
+
         void addReverb(juce::AudioProcessorValueTreeState& params)
         {
-            auto reverb = std::make_unique<ReverbProcessor>();
+            auto reverb = std::make_unique<ReverbProcessor<SampleType>>();
+            reverb->setDelayArena(&delayArena);
+            reverb->setDucker(&ducker);
+            reverb->setModulationMatrix(&modulation);
+            reverb->setSnapshotMorph(&morph);
 
             Reverb::Parameters p;
             p.roomSize = params.getRawParameterValue("roomSize")->load();
@@ -67,45 +122,63 @@ class RackProcessor
             p.dryLevel = 1.0f;
             reverb->setParameters(p);
 
-            auto node = std::make_unique<RoutingNode>();
+            auto node = std::make_unique<RoutingNode<SampleType>>();
             node->effect = std::move(reverb);
             root.children.push_back(std::move(node));
         }
 
         void addDelay(juce::AudioProcessorValueTreeState& params)
         {
-            auto delay = std::make_unique<DelayProcessor>();
+            auto delay = std::make_unique<DelayProcessor<SampleType>>();
+            delay->setDelayArena(&delayArena);
+            delay->setDucker(&ducker);
+            delay->setModulationMatrix(&modulation);
+            delay->setSnapshotMorph(&morph);
 
             delay->setDelayTime(params.getRawParameterValue("delayTime")->load() * _sampleRate);
             delay->setFeedback(params.getRawParameterValue("delayFeedback")->load());
 
-            auto node = std::make_unique<RoutingNode>();
+            auto node = std::make_unique<RoutingNode<SampleType>>();
             node->effect = std::move(delay);
             root.children.push_back(std::move(node));
         }
 
         void addFlanger(juce::AudioProcessorValueTreeState& params)
         {
-            auto flanger = std::make_unique<FlangerProcessor>();
+            auto flanger = std::make_unique<FlangerProcessor<SampleType>>();
+            flanger->setDelayArena(&delayArena);
+            flanger->setModulationMatrix(&modulation);
+            flanger->setSnapshotMorph(&morph);
 
             flanger->setAmountOfStereo(0.8f);
             flanger->setDelay(params.getRawParameterValue("flangerDelay")->load());
             flanger->setFeedback(params.getRawParameterValue("flangerFeedback")->load());
             flanger->setLFODepth(0.6f);
 
-            auto node = std::make_unique<RoutingNode>();
+            auto node = std::make_unique<RoutingNode<SampleType>>();
             node->effect = std::move(flanger);
             root.children.push_back(std::move(node));
         }
 
+        void addConvolution(juce::AudioProcessorValueTreeState& params)
+        {
+            auto convolution = std::make_unique<ConvolutionReverbProcessor<SampleType>>();
+            convolution->setDucker(&ducker);
+            convolution->setMix(params.getRawParameterValue("convolutionMix")->load());
+
+            auto node = std::make_unique<RoutingNode<SampleType>>();
+            node->effect = std::move(convolution);
+            root.children.push_back(std::move(node));
+        }
+
         void addEnd() // Marking the end of node tree
         {
-            auto node = std::make_unique<RoutingNode>();
+            auto node = std::make_unique<RoutingNode<SampleType>>();
             node->effect = nullptr;
             root.children.push_back(std::move(node));
         }
 
-        void printTree(RoutingNode* node, int indent = 0) {
+        void printTree(RoutingNode<SampleType>* node, int indent = 0) {
             for (int i = 0; i < indent; ++i) std::cout << "  ";
             std::cout << "Node ID: " << node->getId() << ", children: " << node->children.size() << std::endl;
         
@@ -123,11 +196,67 @@ class RackProcessor
             this->stretch.setTransposeSemitones(semitones);
         }
 
+        // Any thread. A new quality, link or split setting is built in the background and crossfaded in.
+        using StretchQuality = typename StretchStage<SampleType>::Quality;
+        [[nodiscard]] StretchQuality getStretchQuality() const { return this->stretch.getQuality(); }
+        void setStretchQuality(StretchQuality quality)        { this->stretch.setQuality(quality); }
+        [[nodiscard]] bool getStretchLinked() const { return this->stretch.getLinkedChannels(); }
+        void setStretchLinked(bool linked)          { this->stretch.setLinkedChannels(linked); }
+        [[nodiscard]] bool getStretchSplitComputation() const { return this->stretch.getSplitComputation(); }
+        void setStretchSplitComputation(bool split)          { this->stretch.setSplitComputation(split); }
+
+        /**
+         *  Message thread; applies from the next prepare(). Runs the stretch on a worker
+         *  thread one block behind, keeping its FFTs out of the audio callback for one
+         *  maximum block of extra latency.
+         */
+        [[nodiscard]] bool getStretchAsync() const { return this->stretchAsync; }
+        void setStretchAsync(bool async)          { this->stretchAsync = async; }
+        [[nodiscard]] juce::uint32 getStretchUnderrunSamples() const { return asyncStretch.getUnderrunSamples(); }
+
+        // Time spent in the pitch-shift stage per block, or per worker chunk when async
+        [[nodiscard]] const BlockCostHistogram& getStretchCost() const { return this->stretchCost; }
+        BlockCostHistogram& getStretchCost() { return this->stretchCost; }
+
         void setBPM(double bpm) { this->currentBPM = bpm; }
 
-        RoutingNode& getRoot() { return this->root; }
+        // How long randomised parameters take to glide to their new values; 0 jumps
+        [[nodiscard]] float getMorphBeats() const { return this->morphBeats; }
+        void setMorphBeats(float beats) { this->morphBeats = juce::jmax(0.0f, beats); }
+
+        // Audio thread, after process(): whether the effects now hold the last randomise's draw
+        [[nodiscard]] bool hasMorphFinished() const { return morph.hasFinished(); }
 
-        RackEffect* findProcessor(const juce::String& name)
+        RoutingNode<SampleType>& getRoot() { return this->root; }
+        SidechainDucker<SampleType>& getDucker() { return this->ducker; }
+        ModulationMatrix<SampleType>& getModulation() { return this->modulation; }
+
+        /**
+         *  Serial effects add up; in parallel the slowest branch sets the latency. The
+         *  stretch's depends on its quality, split computation and the async worker.
+         */
+        [[nodiscard]] int getLatencySamples()
+        {
+            int latency = 0;
+            for (auto& child : root.children)
+            {
+                if (child->effect == nullptr)
+                    continue;
+
+                const int effectLatency = child->effect->getLatencySamples();
+                latency = root.getParallel() ? juce::jmax(latency, effectLatency) : latency + effectLatency;
+            }
+
+            // The stretch runs ahead of the tree either way
+            if (stretchEnabled)
+                latency += stretch.getLatencySamples();
+            if (stretchEnabled && asyncStretch.isRunning())
+                latency += asyncStretch.getLatencySamples();
+
+            return latency;
+        }
+
+        RackEffect<SampleType>* findProcessor(const juce::String& name)
         {
             for (auto& child : root.children)
             {
@@ -137,50 +266,54 @@ class RackProcessor
             return nullptr;
         }
 
+        // e.g. findEffect<DelayProcessor>("Delay"), for code that serves both racks
+        template <template <typename> class Effect>
+        Effect<SampleType>* findEffect(const juce::String& name)
+        {
+            return dynamic_cast<Effect<SampleType>*>(findProcessor(name));
+        }
+
     protected:
 
-        void stretchBlock(juce::dsp::AudioBlock<float> &block) {
-            // Determine input and output sample counts
-            inputSamples = static_cast<int>(block.getNumSamples()); 
-            outputSamples = inputSamples; // Adjust as needed for time-stretching
-            numChannels = static_cast<int>(block.getNumChannels());
- 
-            // Prepare input pointers
-            if (inputPointers.size() != numChannels) {
-                inputPointers.resize(numChannels);
-                outputPointers.resize(numChannels);
-            }
-            for (int ch = 0; ch < numChannels; ++ch) {
-                inputPointers[ch] = block.getChannelPointer(ch);
-            }
+        // Without a host tempo a beat is taken as half a second
+        int getMorphSamples() const
+        {
+            const auto beatSeconds = currentBPM > 1.0 ? 60.0 / currentBPM : 0.5;
+            return static_cast<int>(morphBeats * beatSeconds * _sampleRate);
+        }
 
-            // Resize output buffer only if necessary (e.g., if numChannels or outputSamples changes)
-            if (outputBuffer.getNumChannels() != numChannels || outputBuffer.getNumSamples() != outputSamples) {
-                outputBuffer.setSize(numChannels, outputSamples);
-                outputBuffer.clear();
-            }        
-            // Prepare output pointers
-            for (int ch = 0; ch < numChannels; ++ch) {
-                outputPointers[ch] = outputBuffer.getWritePointer(ch);
+        void stretchBlock(juce::dsp::AudioBlock<SampleType> &block) {
+            const int numSamples = static_cast<int>(block.getNumSamples());
+
+            // The stage reads its input from its own history, so it writes straight back into the block
+            jassert(block.getNumChannels() == channelPointers.size());
+            for (size_t ch = 0; ch < channelPointers.size(); ++ch) {
+                channelPointers[ch] = block.getChannelPointer(ch);
             }
 
-            // Process with Signalsmith Stretch
-            stretch.process(inputPointers.data(), inputSamples, outputPointers.data(), outputSamples);
+            // Sparse tracks: once the stretch has flushed, silence would only be copied through it
+            if (stretch.isIdle(channelPointers.data(), numSamples))
+                return;
 
-            // Copy processed data back to the original block 
-            for (int ch = 0; ch < numChannels; ++ch) {
-                std::memcpy(block.getChannelPointer(ch), outputPointers[ch], outputSamples * sizeof(float));
-            }
+            stretch.process(channelPointers.data(), channelPointers.data(), numSamples);
         }
 
     private:
-        RoutingNode root;
-        signalsmith::stretch::SignalsmithStretch<float> stretch;
-        juce::dsp::Limiter<float> limiter;
+        DelayArena delayArena; // outlives the effects in root, which hold pointers into it
+        SidechainDucker<SampleType> ducker; // likewise
+        ModulationMatrix<SampleType> modulation; // likewise
+        SnapshotMorph<SampleType> morph; // likewise
+        RoutingNode<SampleType> root;
+        StretchStage<SampleType> stretch;
+        BlockCostHistogram stretchCost;
+        AsyncStretch<SampleType> asyncStretch { stretch, stretchCost }; // goes before the stretch
+        juce::dsp::Limiter<SampleType> limiter;
 
         bool toRandomize = true;
         bool stretchEnabled = true;
+        bool stretchAsync = false;
         float stretchSemitones = -5.0f;
+        float morphBeats = 4.0f;
         int blockCounter = 0;
         int blocksPerUpdate = 128;
         int blockSamples = 0;
@@ -190,9 +323,6 @@ class RackProcessor
         float _sampleRate = 44100.0f;
         double currentBPM = 1.0;
 
-        // Vars for stretchBlock():
-        int inputSamples, outputSamples, numChannels;
-        std::vector<float*> inputPointers;
-        std::vector<float*> outputPointers;
-        juce::AudioBuffer<float> outputBuffer;
+        // For stretchBlock(), sized in prepare()
+        std::vector<SampleType*> channelPointers;
 };
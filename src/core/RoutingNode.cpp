@@ -2,15 +2,18 @@
 
 static unsigned int instanceCounter = 0;
 
-RoutingNode::RoutingNode() {
+template <typename SampleType>
+RoutingNode<SampleType>::RoutingNode() {
     ownId = ++instanceCounter;
     effect = nullptr;
     //printf("Creating node instance #%u\n", instanceCounter);
 }
 
-RoutingNode::~RoutingNode() {}
+template <typename SampleType>
+RoutingNode<SampleType>::~RoutingNode() {}
 
-void RoutingNode::prepare(const juce::dsp::ProcessSpec& spec) {
+template <typename SampleType>
+void RoutingNode<SampleType>::prepare(const juce::dsp::ProcessSpec& spec) {
     if (effect) { 
         effect->prepare(spec);
 
@@ -37,7 +40,8 @@ void RoutingNode::prepare(const juce::dsp::ProcessSpec& spec) {
 *             /    |    |    \   
 *           FX1   FX2  FX3   FX4
 */
-void RoutingNode::process(juce::dsp::AudioBlock<float>& block) {
+template <typename SampleType>
+void RoutingNode<SampleType>::process(juce::dsp::AudioBlock<SampleType>& block) {
     if (effect && !isParallel) { 
         effect->process(block);
         return;
@@ -50,16 +54,16 @@ void RoutingNode::process(juce::dsp::AudioBlock<float>& block) {
             // Clear the mixBuffer before mixing
             mixBuffer.setSize(numChannels, numSamples, false, false, true);
             mixBuffer.clear();
-            auto mixBlock = juce::dsp::AudioBlock<float>(mixBuffer);
+            auto mixBlock = juce::dsp::AudioBlock<SampleType>(mixBuffer);
 
             for (auto& child : children) {
                 // Prepare temporary buffer for child output
                 tmpBuf.setSize(numChannels, numSamples, false, false, true);
                 tmpBuf.clear();
 
-                juce::dsp::AudioBlock<float> tmpBlock(tmpBuf);
+                juce::dsp::AudioBlock<SampleType> tmpBlock(tmpBuf);
 
-                juce::dsp::ProcessContextReplacing<float> context(block);
+                juce::dsp::ProcessContextReplacing<SampleType> context(block);
 
                 // Let the child process into tmpBlock
                 if (child->effect)
@@ -84,49 +88,50 @@ void RoutingNode::process(juce::dsp::AudioBlock<float>& block) {
     }
 }
 
-unsigned     RoutingNode::getId() {
+template <typename SampleType>
+unsigned     RoutingNode<SampleType>::getId() {
     return ownId;
 }
 
-RoutingNode& RoutingNode::get(const unsigned id) {
+template <typename SampleType>
+RoutingNode<SampleType>& RoutingNode<SampleType>::get(const unsigned id) {
     for (auto& child: children)
         if (child->getId() == id)
             return *child;
     throw std::runtime_error("RoutingNode with ID " + std::to_string(id) + " not found");
 }
 
-void RoutingNode::updateRandomly(float bpm) {
+template <typename SampleType>
+void RoutingNode<SampleType>::updateRandomly(float bpm) {
     if (effect) { 
         effect->updateRandomly(bpm);
         return;
     }
 
-    for (auto& child : children) {
+    // The rack reports the new values once its morph reaches them
+    for (auto& child : children)
         child->updateRandomly(bpm);
-
-        // Notify the sliders of the effect parameters change
-        if (child->effect && onEffectParamsChanged) {
-            juce::MessageManager::callAsync([callback = onEffectParamsChanged,
-                                            ptr = child->effect.get(),
-                                            name = child->effect->getName()] {
-                callback(ptr, name);
-            });
-        }
-    }
 }
 
-bool RoutingNode::getParallel() {
+template <typename SampleType>
+bool RoutingNode<SampleType>::getParallel() {
     return isParallel;
 }
 
-void RoutingNode::setParallel(bool parallel) {
+template <typename SampleType>
+void RoutingNode<SampleType>::setParallel(bool parallel) {
     isParallel = parallel;
 }
 
-void RoutingNode::reset() {
+template <typename SampleType>
+void RoutingNode<SampleType>::reset() {
     if (effect) { effect->reset(); return; }
     for (auto& child : children)
         child->reset();
 }
 
-std::string RoutingNode::getName() { return (effect) ? effect->getName() : "EmptyNode"; }
+template <typename SampleType>
+std::string RoutingNode<SampleType>::getName() { return (effect) ? effect->getName() : "EmptyNode"; }
+
+template class RoutingNode<float>;
+template class RoutingNode<double>;
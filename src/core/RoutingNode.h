@@ -17,13 +17,15 @@
 
 static bool isParallel;
 
+// Defined in RoutingNode.cpp, instantiated there for float and double
+template <typename SampleType>
 class RoutingNode {
 private:
     unsigned int ownId;
     
-    juce::AudioBuffer<float>        mixBuffer;
-    juce::AudioBuffer<float>        tmpBuf;
-    juce::dsp::AudioBlock<float>    tmpBlock;
+    juce::AudioBuffer<SampleType>        mixBuffer;
+    juce::AudioBuffer<SampleType>        tmpBuf;
+    juce::dsp::AudioBlock<SampleType>    tmpBlock;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RoutingNode)
 
@@ -32,11 +34,10 @@ public:
     ~RoutingNode();
     
     std::vector<std::unique_ptr<RoutingNode>> children;
-    std::unique_ptr<RackEffect> effect;
-    std::function<void(RackEffect* effect, const std::string& name)> onEffectParamsChanged{};
+    std::unique_ptr<RackEffect<SampleType>> effect;
 
     void         prepare(const juce::dsp::ProcessSpec& spec);
-    void         process(juce::dsp::AudioBlock<float>& block);
+    void         process(juce::dsp::AudioBlock<SampleType>& block);
     void         reset();
 
     RoutingNode& get(const unsigned id);
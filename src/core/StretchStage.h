@@ -0,0 +1,324 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <signalsmith-stretch.h>
+
+/**
+*   The pitch shifter, with a quality that can change while playing.
+*
+*   Each quality is an analysis block and interval size; a longer block resolves low notes
+*   better, a shorter interval smears transients less, and both cost latency or CPU.
+*   Linking the channels and splitting the computation are also fixed per engine. Configuring
+*   an engine allocates, so a new quality, link or split setting is built on a background thread:
+*
+*       setQuality()      ->  the builder configures (allocates) a new engine for it
+*       process()         ->  picks the engine up and pre-rolls it from the recent input,
+*                             so it starts mid-stream, then runs both and crossfades
+*       fade done         ->  the old engine goes back to the builder to be freed
+*
+*   The pre-roll happens at the hand-over rather than on the builder: seek() is only a
+*   copy, and input that reached the old engine in between would otherwise be missing
+*   from the new one and turn up as a click one latency later.
+*
+*   The engines read their input from the history rather than from the caller's buffers,
+*   so process() can write its output over its input.
+*
+*   Whichever thread calls process() (the audio thread, or the AsyncStretch worker) owns
+*   the engines; everything else goes through atomics. prepare() builds synchronously.
+*/
+template <typename SampleType>
+class StretchStage : private juce::Thread
+{
+public:
+    using Stretch = signalsmith::stretch::SignalsmithStretch<SampleType>;
+
+    enum class Quality { cheap, standard, high };
+
+    struct Sizes
+    {
+        double blockSeconds, intervalSeconds;
+    };
+
+    // Cheap and standard match the library's presetCheaper() and presetDefault()
+    static constexpr Sizes getSizes(Quality quality)
+    {
+        return quality == Quality::cheap    ? Sizes { 0.1, 0.04 }
+             : quality == Quality::standard ? Sizes { 0.12, 0.03 }
+                                            : Sizes { 0.16, 0.02 };
+    }
+
+    StretchStage() : juce::Thread("Deranger stretch builder") {}
+
+    ~StretchStage() override
+    {
+        stopThread(2000);
+        delete pending.exchange(nullptr);
+        delete retired.exchange(nullptr);
+    }
+
+    /** Message thread, with nothing processing. Builds the requested quality in place. */
+    void prepare(int numChannels, int maximumBlockSize, double rate)
+    {
+        stopThread(2000);
+        delete pending.exchange(nullptr);
+        delete retired.exchange(nullptr);
+        incoming.reset();
+        switching = false;
+
+        channels = numChannels;
+        sampleRate = rate;
+        maxBlock = juce::jmax(1, maximumBlockSize);
+
+        built = requested.load();
+        builtLinked = requestedLinked.load();
+        builtSplit = requestedSplit.load();
+        active.reset(build(built, builtLinked, builtSplit));
+        latency.store(getLatency(*active), std::memory_order_relaxed);
+
+        // Enough for seek() at the largest quality: one block and one interval
+        historyLength = static_cast<int>(rate * (getSizes(Quality::high).blockSeconds + getSizes(Quality::high).intervalSeconds));
+        history.setSize(numChannels, historyLength, false, true, false);
+        historyPos = 0;
+
+        scratch.setSize(numChannels, maxBlock, false, true, false);
+        inPointers.resize(static_cast<size_t>(numChannels));
+        outPointers.resize(static_cast<size_t>(numChannels));
+        scratchPointers.resize(static_cast<size_t>(numChannels));
+        fadeLength = juce::jmax(1, static_cast<int>(rate * fadeSeconds));
+
+        startThread(juce::Thread::Priority::low);
+    }
+
+    // Any thread. The engine for it fades in once it has been built.
+    void setQuality(Quality quality)
+    {
+        if (requested.exchange(quality) != quality)
+            notify();
+    }
+
+    [[nodiscard]] Quality getQuality() const { return requested.load(); }
+
+    // Any thread. Predicts phases from the mid and locks every channel to it; swapped in like a quality.
+    void setLinkedChannels(bool linked)
+    {
+        if (requestedLinked.exchange(linked) != linked)
+            notify();
+    }
+
+    [[nodiscard]] bool getLinkedChannels() const { return requestedLinked.load(); }
+
+    /** Any thread. Spreads each interval's FFT work evenly over the blocks of the next interval
+        rather than doing it all in the block where the interval starts, for one interval of
+        extra latency. Swapped in like a quality. */
+    void setSplitComputation(bool split)
+    {
+        if (requestedSplit.exchange(split) != split)
+            notify();
+    }
+
+    [[nodiscard]] bool getSplitComputation() const { return requestedSplit.load(); }
+
+    // Any thread; applied to every engine before the next process()
+    void setTransposeSemitones(float semitones)
+    {
+        pendingSemitones.store(semitones, std::memory_order_relaxed);
+        semitonesChanged.store(true, std::memory_order_release);
+    }
+
+    // Input plus output latency of the engine in use
+    [[nodiscard]] int getLatencySamples() const { return latency.load(std::memory_order_relaxed); }
+
+    /** With nothing processing. A fade in progress completes at once. */
+    void reset()
+    {
+        if (incoming != nullptr)
+            finishFade();
+
+        if (active != nullptr)
+            active->reset();
+
+        history.clear();
+        historyPos = 0;
+    }
+
+    /** Processing thread. True while the engine is only passing silence through and this block is
+        silent as well, so processing it would leave it unchanged; process() can be skipped. */
+    [[nodiscard]] bool isIdle(SampleType* const* inputs, int numSamples) const
+    {
+        return incoming == nullptr && active->passesThrough(inputs, numSamples);
+    }
+
+    /** Processing thread. The outputs may be the inputs. */
+    void process(SampleType* const* inputs, SampleType* const* outputs, int numSamples)
+    {
+        jassert(active != nullptr);
+
+        if (semitonesChanged.exchange(false, std::memory_order_acquire))
+        {
+            const auto semitones = pendingSemitones.load(std::memory_order_relaxed);
+            active->setTransposeSemitones(semitones);
+            if (incoming != nullptr)
+                incoming->setTransposeSemitones(semitones);
+        }
+
+        // Pieces fit the scratch and end at the history's wrap point, so each one's input is contiguous there
+        for (int done = 0; done < numSamples;)
+        {
+            const int count = juce::jmin(maxBlock, numSamples - done, historyLength - historyPos);
+            for (size_t ch = 0; ch < outPointers.size(); ++ch)
+                outPointers[ch] = outputs[ch] + done;
+            processPiece(inputs, done, count);
+            done += count;
+        }
+    }
+
+private:
+    static constexpr double fadeSeconds = 0.05;
+
+    Stretch* build(Quality quality, bool linked, bool split) const
+    {
+        const auto sizes = getSizes(quality);
+        auto* engine = new Stretch();
+        engine->setLinkedChannels(linked);
+        engine->configure(channels, static_cast<int>(sampleRate * sizes.blockSeconds),
+                          static_cast<int>(sampleRate * sizes.intervalSeconds), split);
+        engine->setTransposeSemitones(pendingSemitones.load(std::memory_order_relaxed));
+        return engine;
+    }
+
+    static int getLatency(const Stretch& engine) { return engine.inputLatency() + engine.outputLatency(); }
+
+    // The history ring as seek() reads it, oldest first, without unrolling it
+    struct HistoryView
+    {
+        struct Channel
+        {
+            const SampleType* data;
+            int start, length;
+            SampleType operator[](int i) const { return data[(start + i) % length]; }
+        };
+
+        const juce::AudioBuffer<SampleType>& buffer;
+        int start;
+        Channel operator[](int ch) const { return { buffer.getReadPointer(ch), start, buffer.getNumSamples() }; }
+    };
+
+    void processPiece(SampleType* const* inputs, int offset, int numSamples)
+    {
+        // One engine at a time: a new one waits until the old fade has been collected
+        if (incoming == nullptr && retired.load(std::memory_order_relaxed) == nullptr)
+        {
+            if (auto* next = pending.exchange(nullptr, std::memory_order_acquire))
+            {
+                next->setTransposeSemitones(pendingSemitones.load(std::memory_order_relaxed));
+                next->seek(HistoryView { history, historyPos }, historyLength, 1.0);
+                incoming.reset(next);
+
+                // A pre-rolled engine takes about its output latency to reach full level
+                fadePosition = -next->outputLatency();
+            }
+        }
+
+        writeHistory(inputs, offset, numSamples);
+
+        if (incoming == nullptr)
+        {
+            active->process(inPointers.data(), numSamples, outPointers.data(), numSamples);
+            return;
+        }
+
+        for (size_t ch = 0; ch < scratchPointers.size(); ++ch)
+            scratchPointers[ch] = scratch.getWritePointer(static_cast<int>(ch));
+        incoming->process(inPointers.data(), numSamples, scratchPointers.data(), numSamples);
+        active->process(inPointers.data(), numSamples, outPointers.data(), numSamples);
+
+        const auto step = SampleType(1) / static_cast<SampleType>(fadeLength);
+        for (size_t ch = 0; ch < outPointers.size(); ++ch)
+        {
+            auto* out = outPointers[ch];
+            const auto* in = scratchPointers[ch];
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto gain = juce::jlimit(SampleType(0), SampleType(1), static_cast<SampleType>(fadePosition + i) * step);
+                out[i] += (in[i] - out[i]) * gain;
+            }
+        }
+
+        fadePosition += numSamples;
+        if (fadePosition >= fadeLength)
+            finishFade();
+    }
+
+    void finishFade()
+    {
+        retired.store(active.release(), std::memory_order_release);
+        active = std::move(incoming);
+        latency.store(getLatency(*active), std::memory_order_relaxed);
+        switching = false;
+    }
+
+    // Copies a piece into the history, where the engines then read it from; pieces never wrap
+    void writeHistory(SampleType* const* inputs, int offset, int numSamples)
+    {
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            history.copyFrom(ch, historyPos, inputs[ch] + offset, numSamples);
+            inPointers[static_cast<size_t>(ch)] = history.getWritePointer(ch, historyPos);
+        }
+        historyPos = (historyPos + numSamples) % historyLength;
+    }
+
+    // Builder thread
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            delete retired.exchange(nullptr, std::memory_order_acquire);
+
+            const auto quality = requested.load();
+            const bool linked = requestedLinked.load();
+            const bool split = requestedSplit.load();
+            if (switching || (quality == built && linked == builtLinked && split == builtSplit))
+            {
+                wait(50);
+                continue;
+            }
+
+            auto* engine = build(quality, linked, split);
+            built = quality;
+            builtLinked = linked;
+            builtSplit = split;
+            switching = true;
+            pending.store(engine, std::memory_order_release);
+        }
+    }
+
+    std::unique_ptr<Stretch> active, incoming;  // processing thread
+    std::atomic<Stretch*> pending { nullptr };  // builder -> processing
+    std::atomic<Stretch*> retired { nullptr };  // processing -> builder, to be freed
+
+    std::atomic<Quality> requested { Quality::standard };
+    Quality built = Quality::standard;          // builder, or prepare()
+    std::atomic<bool> requestedLinked { false };
+    bool builtLinked = false;                   // builder, or prepare()
+    std::atomic<bool> requestedSplit { false };
+    bool builtSplit = false;                    // builder, or prepare()
+    std::atomic<bool> switching { false };      // from publishing an engine until its fade ends
+    std::atomic<int> latency { 0 };
+
+    std::atomic<float> pendingSemitones { 0.0f };
+    std::atomic<bool> semitonesChanged { false };
+
+    // Recent input: what the engines read, and the pre-roll for the next one; processing thread
+    juce::AudioBuffer<SampleType> history;
+    int historyLength = 1, historyPos = 0;
+
+    juce::AudioBuffer<SampleType> scratch;
+    std::vector<SampleType*> inPointers, outPointers, scratchPointers;
+    int fadeLength = 1, fadePosition = 0;
+
+    int channels = 0, maxBlock = 1;
+    double sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE(StretchStage)
+};
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayArena.h"
+#include "BlockSmoother.h"
+
+/**
+*   juce::dsp::Reverb (Freeverb) reworked to run a block at a time, to within float rounding.
+*
+*   Every comb and allpass delay is longer than the chunk this processes at once, so
+*   nothing read inside a chunk was written inside it. That lets each chunk:
+*     - copy the next taps of all 8 combs into one interleaved array (contiguous copies),
+*     - run the comb recursion with the 8 combs as SIMD lanes,
+*     - write the comb inputs back with contiguous copies,
+*     - run each allpass stage over the whole chunk as an element-wise loop.
+*
+*   Arithmetic follows juce::Reverb, including JUCE_UNDENORMALISE, but the output isn't
+*   bit-identical: tests/BlockFreeverbCheck.cpp finds it differs by up to about 1e-5 of the
+*   peak. Buffers come from the DelayArena.
+*/
+template <typename SampleType>
+class BlockFreeverb : public DelayArena::Client
+{
+public:
+    using Parameters = juce::dsp::Reverb::Parameters;
+
+    BlockFreeverb() { setParameters(Parameters()); }
+
+    void prepare(DelayArena& arena, const juce::dsp::ProcessSpec& spec)
+    {
+        preparedRate = spec.sampleRate;
+        computeSizes(spec.sampleRate, combCapacity, allPassCapacity);
+        applyRate(spec.sampleRate);
+
+        combLanes.resize(static_cast<size_t>(chunkSize));
+        for (auto* scratch : { &inputs, &outputsL, &outputsR, &damps, &feedbacks, &dryGains, &wetGains1, &wetGains2 })
+            scratch->resize(static_cast<size_t>(chunkSize));
+
+        memory = nullptr;
+        arena.add(*this);
+    }
+
+    /**
+    *   Audio thread. Runs at a rate at or below the prepared one inside the same buffers,
+    *   which are then only partly used. Clears the tail.
+    */
+    void setProcessingRate(double rate)
+    {
+        jassert(rate <= preparedRate);
+        applyRate(juce::jmin(rate, preparedRate));
+        bindMemory(reinterpret_cast<char*>(memory), 0);
+    }
+
+    void reset()
+    {
+        for (auto& bank : combLast)
+            std::fill(std::begin(bank.values), std::end(bank.values), SampleType(0));
+
+        if (memory != nullptr)
+            std::fill(memory, memory + totalSize(combCapacity, allPassCapacity), SampleType(0));
+    }
+
+    [[nodiscard]] const Parameters& getParameters() const noexcept { return parameters; }
+
+    void setParameters(const Parameters& newParams)
+    {
+        const float wetScaleFactor = 3.0f;
+        const float dryScaleFactor = 2.0f;
+
+        const float wet = newParams.wetLevel * wetScaleFactor;
+        dryGain.setTargetValue(newParams.dryLevel * dryScaleFactor);
+        wetGain1.setTargetValue(0.5f * wet * (1.0f + newParams.width));
+        wetGain2.setTargetValue(0.5f * wet * (1.0f - newParams.width));
+
+        const bool frozen = newParams.freezeMode >= 0.5f;
+        gain = frozen ? 0.0f : 0.015f;
+        parameters = newParams;
+
+        damping.setTargetValue(frozen ? 0.0f : parameters.damping * 0.4f);
+        feedback.setTargetValue(frozen ? 1.0f : parameters.roomSize * 0.28f + 0.7f);
+    }
+
+    // wetScale, if given, is a per-sample gain on the wet signal only
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context, const SampleType* wetScale = nullptr)
+    {
+        auto& block = context.getOutputBlock();
+        const auto numSamples = static_cast<int>(block.getNumSamples());
+
+        if (context.isBypassed || memory == nullptr)
+            return;
+
+        if (block.getNumChannels() == 1)
+            processMono(block.getChannelPointer(0), numSamples, wetScale);
+        else if (block.getNumChannels() == 2)
+            processStereo(block.getChannelPointer(0), block.getChannelPointer(1), numSamples, wetScale);
+        else
+            jassertfalse;
+    }
+
+    [[nodiscard]] size_t getRequiredFrames(double rate) const override
+    {
+        SizeTable combs, allPasses;
+        computeSizes(rate, combs, allPasses);
+        return totalSize(combs, allPasses);
+    }
+
+    [[nodiscard]] size_t getBytesPerFrame() const override { return sizeof(SampleType); }
+
+    void bindMemory(char* newMemory, size_t) override
+    {
+        memory = reinterpret_cast<SampleType*>(newMemory);
+        if (memory == nullptr)
+            return;
+
+        auto* next = memory;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            for (int j = 0; j < numCombs; ++j)
+            {
+                combBuffers[static_cast<size_t>(ch)][static_cast<size_t>(j)] = next;
+                combIndex[static_cast<size_t>(ch)][static_cast<size_t>(j)] = 0;
+                next += combCapacity[static_cast<size_t>(ch)][static_cast<size_t>(j)];
+            }
+
+            for (int j = 0; j < numAllPasses; ++j)
+            {
+                allPassBuffers[static_cast<size_t>(ch)][static_cast<size_t>(j)] = next;
+                allPassIndex[static_cast<size_t>(ch)][static_cast<size_t>(j)] = 0;
+                next += allPassCapacity[static_cast<size_t>(ch)][static_cast<size_t>(j)];
+            }
+        }
+
+        reset();
+    }
+
+private:
+    static constexpr int numChannels = 2, numCombs = 8, numAllPasses = 4;
+    static constexpr int stereoSpread = 23;
+
+    using Vec = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr int lanes = static_cast<int>(Vec::SIMDNumElements);
+
+    struct alignas(32) CombLanes
+    {
+        SampleType values[numCombs] {};
+    };
+
+    using SizeTable = std::array<std::array<int, numCombs>, numChannels>;
+
+    static void computeSizes(double sampleRate, SizeTable& combs, SizeTable& allPasses)
+    {
+        static constexpr short combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+        static constexpr short allPassTunings[] = { 556, 441, 341, 225 };
+        const int intSampleRate = static_cast<int>(sampleRate);
+
+        for (int i = 0; i < numCombs; ++i)
+        {
+            combs[0][static_cast<size_t>(i)] = (intSampleRate * combTunings[i]) / 44100;
+            combs[1][static_cast<size_t>(i)] = (intSampleRate * (combTunings[i] + stereoSpread)) / 44100;
+        }
+
+        for (auto& row : allPasses)
+            row.fill(0);
+
+        for (int i = 0; i < numAllPasses; ++i)
+        {
+            allPasses[0][static_cast<size_t>(i)] = (intSampleRate * allPassTunings[i]) / 44100;
+            allPasses[1][static_cast<size_t>(i)] = (intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100;
+        }
+    }
+
+    // Filter lengths, chunk size and smoothing for the rate the filters run at
+    void applyRate(double rate)
+    {
+        computeSizes(rate, combSizes, allPassSizes);
+
+        chunkSize = std::numeric_limits<int>::max();
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            for (int j = 0; j < numCombs; ++j)
+                chunkSize = juce::jmin(chunkSize, combSizes[static_cast<size_t>(ch)][static_cast<size_t>(j)]);
+            for (int j = 0; j < numAllPasses; ++j)
+                chunkSize = juce::jmin(chunkSize, allPassSizes[static_cast<size_t>(ch)][static_cast<size_t>(j)]);
+        }
+        chunkSize = juce::jmax(1, chunkSize);
+
+        const auto smoothTime = 0.01;
+        damping .reset(rate, smoothTime);
+        feedback.reset(rate, smoothTime);
+        dryGain .reset(rate, smoothTime);
+        wetGain1.reset(rate, smoothTime);
+        wetGain2.reset(rate, smoothTime);
+    }
+
+    static size_t totalSize(const SizeTable& combs, const SizeTable& allPasses)
+    {
+        size_t total = 0;
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int j = 0; j < numCombs; ++j)
+                total += static_cast<size_t>(combs[static_cast<size_t>(ch)][static_cast<size_t>(j)])
+                       + static_cast<size_t>(allPasses[static_cast<size_t>(ch)][static_cast<size_t>(j)]);
+        return total;
+    }
+
+    void processStereo(SampleType* left, SampleType* right, int numSamples, const SampleType* wetScale)
+    {
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int len = juce::jmin(chunkSize, numSamples - start);
+            auto* l = left + start;
+            auto* r = right + start;
+
+            for (int i = 0; i < len; ++i)
+                inputs[static_cast<size_t>(i)] = (l[i] + r[i]) * gain;
+
+            fillGains(len, true, wetScale != nullptr ? wetScale + start : nullptr);
+
+            runCombs(0, len, outputsL.data());
+            runCombs(1, len, outputsR.data());
+            runAllPasses(0, len, outputsL.data());
+            runAllPasses(1, len, outputsR.data());
+
+            for (int i = 0; i < len; ++i)
+            {
+                const auto outL = outputsL[static_cast<size_t>(i)];
+                const auto outR = outputsR[static_cast<size_t>(i)];
+                const auto dry  = dryGains[static_cast<size_t>(i)];
+                const auto wet1 = wetGains1[static_cast<size_t>(i)];
+                const auto wet2 = wetGains2[static_cast<size_t>(i)];
+
+                l[i] = outL * wet1 + outR * wet2 + l[i] * dry;
+                r[i] = outR * wet1 + outL * wet2 + r[i] * dry;
+            }
+        }
+    }
+
+    void processMono(SampleType* samples, int numSamples, const SampleType* wetScale)
+    {
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int len = juce::jmin(chunkSize, numSamples - start);
+            auto* s = samples + start;
+
+            for (int i = 0; i < len; ++i)
+                inputs[static_cast<size_t>(i)] = s[i] * gain;
+
+            fillGains(len, false, wetScale != nullptr ? wetScale + start : nullptr);
+
+            runCombs(0, len, outputsL.data());
+            runAllPasses(0, len, outputsL.data());
+
+            for (int i = 0; i < len; ++i)
+                s[i] = outputsL[static_cast<size_t>(i)] * wetGains1[static_cast<size_t>(i)] + s[i] * dryGains[static_cast<size_t>(i)];
+        }
+    }
+
+    // A chunk of every smoothed parameter, so the loops above read arrays and vectorise
+    void fillGains(int len, bool stereo, const SampleType* wetScale)
+    {
+        damping .fill(damps.data(), len);
+        feedback.fill(feedbacks.data(), len);
+        dryGain .fill(dryGains.data(), len);
+        wetGain1.fill(wetGains1.data(), len);
+
+        if (wetScale != nullptr)
+            juce::FloatVectorOperations::multiply(wetGains1.data(), wetScale, len);
+
+        // Mono never reads the cross-feed gain, and juce::Reverb doesn't advance it there either
+        if (stereo)
+        {
+            wetGain2.fill(wetGains2.data(), len);
+
+            if (wetScale != nullptr)
+                juce::FloatVectorOperations::multiply(wetGains2.data(), wetScale, len);
+        }
+    }
+
+    void runCombs(int ch, int len, SampleType* out)
+    {
+        const auto c = static_cast<size_t>(ch);
+
+        // Gather: the next len taps of every comb, interleaved one frame per sample
+        for (int j = 0; j < numCombs; ++j)
+        {
+            const auto* buffer = combBuffers[c][static_cast<size_t>(j)];
+            const int index = combIndex[c][static_cast<size_t>(j)];
+            const int firstRun = juce::jmin(len, combSizes[c][static_cast<size_t>(j)] - index);
+
+            for (int i = 0; i < firstRun; ++i)
+                combLanes[static_cast<size_t>(i)].values[j] = buffer[index + i];
+            for (int i = firstRun; i < len; ++i)
+                combLanes[static_cast<size_t>(i)].values[j] = buffer[i - firstRun];
+        }
+
+        Vec last[numCombs / lanes];
+        for (int g = 0; g < numCombs / lanes; ++g)
+            last[g] = Vec::fromRawArray(combLast[c].values + g * lanes);
+
+        for (int i = 0; i < len; ++i)
+        {
+            auto& frame = combLanes[static_cast<size_t>(i)];
+            const SampleType damp = damps[static_cast<size_t>(i)];
+            const SampleType oneMinusDamp = 1.0f - damp;
+            const SampleType feedbck = feedbacks[static_cast<size_t>(i)];
+            const auto input = Vec::expand(inputs[static_cast<size_t>(i)]);
+
+            // Summed in comb order, as juce::Reverb does
+            SampleType output = 0;
+            for (int j = 0; j < numCombs; ++j)
+                output += frame.values[j];
+            out[i] = output;
+
+            for (int g = 0; g < numCombs / lanes; ++g)
+            {
+                const auto tap = Vec::fromRawArray(frame.values + g * lanes);
+
+                last[g] = (tap * oneMinusDamp) + (last[g] * damp);
+                JUCE_UNDENORMALISE(last[g]);
+
+                auto temp = input + (last[g] * feedbck);
+                JUCE_UNDENORMALISE(temp);
+                temp.copyToRawArray(frame.values + g * lanes);
+            }
+        }
+
+        for (int g = 0; g < numCombs / lanes; ++g)
+            last[g].copyToRawArray(combLast[c].values + g * lanes);
+
+        // Scatter the new comb inputs back where the taps came from
+        for (int j = 0; j < numCombs; ++j)
+        {
+            auto* buffer = combBuffers[c][static_cast<size_t>(j)];
+            const int size = combSizes[c][static_cast<size_t>(j)];
+            int& index = combIndex[c][static_cast<size_t>(j)];
+            const int firstRun = juce::jmin(len, size - index);
+
+            for (int i = 0; i < firstRun; ++i)
+                buffer[index + i] = combLanes[static_cast<size_t>(i)].values[j];
+            for (int i = firstRun; i < len; ++i)
+                buffer[i - firstRun] = combLanes[static_cast<size_t>(i)].values[j];
+
+            index = (index + len) % size;
+        }
+    }
+
+    void runAllPasses(int ch, int len, SampleType* samples)
+    {
+        const auto c = static_cast<size_t>(ch);
+
+        for (int j = 0; j < numAllPasses; ++j)
+        {
+            auto* buffer = allPassBuffers[c][static_cast<size_t>(j)];
+            const int size = allPassSizes[c][static_cast<size_t>(j)];
+            int& index = allPassIndex[c][static_cast<size_t>(j)];
+
+            // At most one wrap per chunk: two straight runs the compiler can vectorise
+            const int firstRun = juce::jmin(len, size - index);
+            allPassRun(buffer + index, samples, firstRun);
+            allPassRun(buffer, samples + firstRun, len - firstRun);
+
+            index = (index + len) % size;
+        }
+    }
+
+    static void allPassRun(SampleType* buffer, SampleType* samples, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const SampleType bufferedValue = buffer[i];
+            SampleType temp = samples[i] + (bufferedValue * 0.5f);
+            JUCE_UNDENORMALISE(temp);
+            buffer[i] = temp;
+            samples[i] = bufferedValue - samples[i];
+        }
+    }
+
+    SizeTable combSizes {}, allPassSizes {};        // at the processing rate
+    SizeTable combCapacity {}, allPassCapacity {};  // at the prepared rate, as laid out in memory
+    std::array<std::array<SampleType*, numCombs>, numChannels> combBuffers {}, allPassBuffers {};
+    std::array<std::array<int, numCombs>, numChannels> combIndex {}, allPassIndex {};
+    std::array<CombLanes, numChannels> combLast {};
+
+    SampleType* memory = nullptr;
+    int chunkSize = 1;
+    double preparedRate = 44100.0;
+
+    std::vector<CombLanes> combLanes;
+    std::vector<SampleType> inputs, outputsL, outputsR, damps, feedbacks, dryGains, wetGains1, wetGains2;
+
+    Parameters parameters;
+    float gain = 0.015f;
+    BlockSmoother<float> damping, feedback, dryGain, wetGain1, wetGain2;
+};
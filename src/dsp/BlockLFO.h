@@ -0,0 +1,175 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+*   Phase-accumulator LFO that renders a whole block of modulation at once.
+*
+*   Shapes are stored as small wavetables read with linear interpolation, so the output
+*   is piecewise linear in time: every stretch between two table points is a straight
+*   ramp. A block is filled ramp by ramp, and each ramp is a plain loop the compiler
+*   turns into SIMD. Only the few table-point crossings per block touch scalar code.
+*
+*   Each output channel can be given a phase offset in cycles (0..1). Output is -1..1.
+*/
+template <typename SampleType>
+class BlockLFO
+{
+public:
+    enum class Shape { Sine, Triangle, RandomSmooth };
+
+    static constexpr int maxChannels = 2;
+
+    BlockLFO()
+    {
+        for (int i = 0; i <= tableSize; ++i)
+        {
+            const auto phase = static_cast<double>(i) / tableSize;
+
+            sineTable[i]     = static_cast<SampleType>(std::sin(juce::MathConstants<double>::twoPi * phase));
+            triangleTable[i] = static_cast<SampleType>(phase < 0.25 ? 4.0 * phase
+                                                     : phase < 0.75 ? 2.0 - 4.0 * phase
+                                                                    : 4.0 * phase - 4.0);
+            // Random-smooth glides between two random points along a raised cosine
+            easeTable[i]     = static_cast<SampleType>(0.5 - 0.5 * std::cos(juce::MathConstants<double>::pi * phase));
+        }
+    }
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        setFrequency(frequency);
+        reset();
+    }
+
+    void reset()
+    {
+        phase = 0;
+        cycle = 0;
+        generatedUpTo = -1;
+        ensureRandomPoints(2);
+    }
+
+    void setFrequency(SampleType hz)
+    {
+        frequency = hz;
+        increment = static_cast<SampleType>(hz / sampleRate);
+    }
+
+    void setShape(Shape newShape) { shape = newShape; }
+    [[nodiscard]] Shape getShape() const { return shape; }
+
+    // In cycles; a quarter cycle is the classic 90 degree stereo spread
+    void setPhaseOffset(int channel, SampleType cycles)
+    {
+        jassert(juce::isPositiveAndBelow(channel, maxChannels));
+        phaseOffsets[static_cast<size_t>(channel)] = cycles - std::floor(cycles);
+    }
+
+    /** Fills numSamples of modulation for each channel and advances the LFO by one block. */
+    void process(SampleType* const* outputs, int numChannels, int numSamples)
+    {
+        jassert(numChannels <= maxChannels);
+
+        // Offsets are below one cycle, so no channel runs more than a cycle ahead of the phase
+        const auto cyclesThisBlock = static_cast<int>(std::ceil(increment * numSamples));
+        jassert(cyclesThisBlock + 3 <= randomLookahead);
+        ensureRandomPoints(cycle + cyclesThisBlock + 2);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto p = phase + phaseOffsets[static_cast<size_t>(ch)];
+            auto c = cycle;
+            if (p >= 1) { p -= 1; ++c; }
+
+            renderChannel(outputs[ch], numSamples, p, c);
+        }
+
+        phase += increment * static_cast<SampleType>(numSamples);
+        const auto wraps = static_cast<int>(std::floor(phase));
+        phase -= static_cast<SampleType>(wraps);
+        cycle += wraps;
+    }
+
+private:
+    static constexpr int tableSize = 256;
+    static constexpr int randomLookahead = 8;   // ring of random points, one per cycle
+
+    void renderChannel(SampleType* out, int numSamples, SampleType p, int c) const
+    {
+        int done = 0;
+
+        while (done < numSamples)
+        {
+            // Table point this phase sits after, and how many samples until the next one
+            const auto scaled = p * static_cast<SampleType>(tableSize);
+            const auto index = juce::jmin(static_cast<int>(scaled), tableSize - 1);
+            const auto frac = scaled - static_cast<SampleType>(index);
+
+            int run = numSamples - done;
+            if (increment > 0)
+            {
+                const auto toNext = (static_cast<SampleType>(1) - frac) / (increment * static_cast<SampleType>(tableSize));
+                run = juce::jlimit(1, run, static_cast<int>(std::ceil(toNext)));
+            }
+
+            SampleType start, slopePerTablePoint;
+            segment(index, frac, c, start, slopePerTablePoint);
+
+            fillRamp(out + done, run, start, slopePerTablePoint * increment * static_cast<SampleType>(tableSize));
+
+            done += run;
+            p += increment * static_cast<SampleType>(run);
+            if (p >= 1) { p -= 1; ++c; }
+        }
+    }
+
+    // Value at (index + frac) and the change per table step for the current shape
+    void segment(int index, SampleType frac, int c, SampleType& start, SampleType& slope) const
+    {
+        const SampleType* table = shape == Shape::Sine ? sineTable.data()
+                                : shape == Shape::Triangle ? triangleTable.data()
+                                : easeTable.data();
+
+        const auto a = table[index], b = table[index + 1];
+        start = a + frac * (b - a);
+        slope = b - a;
+
+        if (shape == Shape::RandomSmooth)
+        {
+            const auto from = randomPoints[static_cast<size_t>(c & (randomLookahead - 1))];
+            const auto to = randomPoints[static_cast<size_t>((c + 1) & (randomLookahead - 1))];
+            start = from + (to - from) * start;
+            slope = (to - from) * slope;
+        }
+    }
+
+    // Kept as a bare loop so it vectorises
+    static void fillRamp(SampleType* out, int n, SampleType start, SampleType step)
+    {
+        for (int i = 0; i < n; ++i)
+            out[i] = start + step * static_cast<SampleType>(i);
+    }
+
+    void ensureRandomPoints(int upToCycle)
+    {
+        while (generatedUpTo < upToCycle)
+        {
+            ++generatedUpTo;
+            randomPoints[static_cast<size_t>(generatedUpTo & (randomLookahead - 1))]
+                = static_cast<SampleType>(rand.nextFloat() * 2.0f - 1.0f);
+        }
+    }
+
+    std::array<SampleType, tableSize + 1> sineTable {}, triangleTable {}, easeTable {};
+    std::array<SampleType, randomLookahead> randomPoints {};
+    std::array<SampleType, maxChannels> phaseOffsets {};
+
+    Shape shape = Shape::Sine;
+    double sampleRate = 44100.0;
+    SampleType frequency = 0.33f, increment = 0;
+    SampleType phase = 0;
+    int cycle = 0, generatedUpTo = -1;
+
+    juce::Random rand;
+};
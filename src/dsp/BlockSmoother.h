@@ -0,0 +1,150 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+*   Linear parameter smoothing handed out a block at a time, in place of calling
+*   LinearSmoothedValue::getNextValue() once per sample.
+*
+*   A settled parameter, which is most of them on most blocks, comes back as one constant
+*   the kernel can hoist out of its loop. A moving one comes back as a ramp buffer, filled
+*   with a single multiply-add per sample that the compiler vectorises, which the kernel
+*   can then use as a vector operand:
+*
+*       const auto gain = smoothedGain.next(numSamples);
+*       if (gain.isConstant())
+*           FloatVectorOperations::multiply(samples, gain.value, numSamples);
+*       else
+*           FloatVectorOperations::multiply(samples, gain.ramp, numSamples);
+*
+*   Timing and targets behave as in LinearSmoothedValue. A ModulationMatrix can add a
+*   per-sample offset on top for a block, which makes that block a ramp.
+*/
+template <typename ValueType>
+class BlockSmoother
+{
+public:
+    struct Block
+    {
+        const ValueType* ramp;  // nullptr when settled for the whole block
+        ValueType value;        // the settled value, or where the ramp ends
+
+        [[nodiscard]] bool isConstant() const { return ramp == nullptr; }
+        ValueType operator[](int i) const { return ramp != nullptr ? ramp[i] : value; }
+    };
+
+    BlockSmoother(ValueType initialValue = ValueType()) : current(initialValue), target(initialValue) {}
+
+    // Message thread. Only needed for next(); fill() writes into the caller's buffer.
+    void prepare(int maximumBlockSize) { ramp.resize(static_cast<size_t>(maximumBlockSize)); }
+
+    // Same as LinearSmoothedValue::reset(): sets the ramp length and jumps to the target
+    void reset(double sampleRate, double rampLengthSeconds)
+    {
+        stepsToTarget = static_cast<int>(std::floor(rampLengthSeconds * sampleRate));
+        setCurrentAndTargetValue(target);
+    }
+
+    void setTargetValue(ValueType newTarget)
+    {
+        if (newTarget == target)
+            return;
+
+        if (stepsToTarget <= 0)
+        {
+            setCurrentAndTargetValue(newTarget);
+            return;
+        }
+
+        target = newTarget;
+        countdown = stepsToTarget;
+        step = (target - current) / static_cast<ValueType>(countdown);
+    }
+
+    void setCurrentAndTargetValue(ValueType newValue)
+    {
+        current = target = newValue;
+        countdown = 0;
+    }
+
+    [[nodiscard]] ValueType getTargetValue() const { return target; }
+    [[nodiscard]] ValueType getCurrentValue() const { return current; }
+    [[nodiscard]] bool isSmoothing() const { return countdown > 0; }
+
+    /**
+    *   Audio thread. Offsets to add to the values handed out over the next block, clamped
+    *   to [lowest, highest]; nullptr stops modulating. The target stays unmodulated.
+    */
+    void setModulation(const ValueType* newOffsets, ValueType lowest, ValueType highest)
+    {
+        offsets = newOffsets;
+        offsetPosition = 0;
+        modulationRange = { lowest, highest };
+    }
+
+    /** Audio thread. Advances by numSamples, at most the size given to prepare(). */
+    Block next(int numSamples)
+    {
+        if (countdown <= 0 && offsets == nullptr)
+            return { nullptr, target };
+
+        jassert(numSamples <= static_cast<int>(ramp.size()));
+        fill(ramp.data(), numSamples);
+        return { ramp.data(), ramp[static_cast<size_t>(numSamples - 1)] };
+    }
+
+    /** Audio thread. Advances by numSamples, writing each sample's value to dest. */
+    template <typename Dest>
+    void fill(Dest* dest, int numSamples)
+    {
+        fillSmoothed(dest, numSamples);
+
+        if (offsets == nullptr)
+            return;
+
+        const auto* offset = offsets + offsetPosition;
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = static_cast<Dest>(juce::jlimit(modulationRange.first, modulationRange.second,
+                                                     static_cast<ValueType>(dest[i]) + offset[i]));
+
+        offsetPosition += numSamples;
+    }
+
+private:
+    template <typename Dest>
+    void fillSmoothed(Dest* dest, int numSamples)
+    {
+        if (countdown <= 0)
+        {
+            std::fill(dest, dest + numSamples, static_cast<Dest>(target));
+            return;
+        }
+
+        const auto rampLength = juce::jmin(numSamples, countdown);
+        const auto start = current;
+
+        for (int i = 0; i < rampLength; ++i)
+            dest[i] = static_cast<Dest>(start + step * static_cast<ValueType>(i + 1));
+
+        countdown -= rampLength;
+
+        if (countdown > 0)
+        {
+            current = start + step * static_cast<ValueType>(rampLength);
+            return;
+        }
+
+        // The last ramp sample lands on the target exactly, as LinearSmoothedValue does
+        current = target;
+        dest[rampLength - 1] = static_cast<Dest>(target);
+        std::fill(dest + rampLength, dest + numSamples, static_cast<Dest>(target));
+    }
+
+    ValueType current, target, step = ValueType();
+    int countdown = 0, stepsToTarget = 0;
+    std::vector<ValueType> ramp;
+
+    const ValueType* offsets = nullptr;
+    int offsetPosition = 0;
+    std::pair<ValueType, ValueType> modulationRange;
+};
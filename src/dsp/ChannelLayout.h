@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+*   Picks a kernel instantiated for the session's channel count.
+*
+*   isBusesLayoutSupported() only lets mono and stereo through, so per-channel loops are
+*   compiled for 1 and 2 channels with the count as a constant: they unroll, and the two
+*   channels of a stereo frame can share a SIMD register. Any other count takes the
+*   instantiation for `runtime`, which reads numChannels as before.
+*
+*       // prepare()
+*       channelLayout = ChannelLayout::forChannels(numChannels);
+*       // process()
+*       channelLayout.dispatch([&](auto channels) { processFrames<decltype(channels)::value>(block); });
+*/
+class ChannelLayout
+{
+public:
+    static constexpr int runtime = 0;
+
+    ChannelLayout() = default;
+
+    static ChannelLayout forChannels(int numChannels)
+    {
+        return ChannelLayout(numChannels == 1 || numChannels == 2 ? numChannels : runtime);
+    }
+
+    /** Calls fn with a std::integral_constant<int> of 1, 2 or runtime. */
+    template <typename Fn>
+    decltype(auto) dispatch(Fn&& fn) const
+    {
+        switch (fixedChannels)
+        {
+            case 1:  return fn(std::integral_constant<int, 1> {});
+            case 2:  return fn(std::integral_constant<int, 2> {});
+            default: return fn(std::integral_constant<int, runtime> {});
+        }
+    }
+
+    // Loop bound inside a kernel compiled for Channels
+    template <int Channels>
+    static constexpr int count(int numChannels) { return Channels == runtime ? numChannels : Channels; }
+
+    [[nodiscard]] int getFixedChannels() const { return fixedChannels; }
+
+private:
+    explicit ChannelLayout(int channels) : fixedChannels(channels) {}
+
+    int fixedChannels = runtime;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+*   Per-instance memory for every delay line in the rack.
+*
+*   One contiguous block is carved into power-of-two regions, one per line. The block
+*   only ever grows: it is sized for the highest sample rate seen so far, so repeated
+*   prepare calls (transport restarts, rate flips back and forth) reuse it as-is.
+*
+*   Layout happens around RackProcessor::prepare(), on the message thread:
+*       beginLayout(rate)  ->  each line registers itself from its prepare()
+*       endLayout()        ->  grows the block if needed, binds and clears every region
+*/
+class DelayArena
+{
+public:
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+
+        [[nodiscard]] virtual size_t getRequiredFrames(double sampleRate) const = 0;
+        [[nodiscard]] virtual size_t getBytesPerFrame() const = 0;
+        virtual void bindMemory(char* memory, size_t frames) = 0;
+    };
+
+    DelayArena() = default;
+
+    void beginLayout(double sampleRate)
+    {
+        highestSampleRate = juce::jmax(highestSampleRate, sampleRate);
+        clients.clear();
+    }
+
+    void add(Client& client) { clients.push_back(&client); }
+
+    void endLayout()
+    {
+        computeRegions();
+        const size_t bytesNeeded = totalBytes();
+
+        if (bytesNeeded > capacity)
+        {
+            memory.allocate(bytesNeeded + alignment, false);
+            capacity = bytesNeeded;
+        }
+
+        auto* base = alignedBase();
+        for (auto& region : regions)
+            region.client->bindMemory(base + region.offset, region.frames);
+    }
+
+private:
+    static constexpr size_t alignment = 64;
+
+    struct Region
+    {
+        Client* client = nullptr;
+        size_t frames = 0;
+        size_t offset = 0;
+    };
+
+    void computeRegions()
+    {
+        regions.resize(clients.size());
+        size_t offset = 0;
+
+        for (size_t i = 0; i < clients.size(); ++i)
+        {
+            auto* client = clients[i];
+            const auto frames = static_cast<size_t>(juce::nextPowerOfTwo(
+                static_cast<int>(client->getRequiredFrames(highestSampleRate))));
+
+            regions[i] = { client, frames, offset };
+            offset += (frames * client->getBytesPerFrame() + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    [[nodiscard]] size_t totalBytes() const
+    {
+        if (regions.empty())
+            return 0;
+
+        const auto& last = regions.back();
+        return last.offset + last.frames * last.client->getBytesPerFrame();
+    }
+
+    [[nodiscard]] char* alignedBase() const
+    {
+        const auto address = reinterpret_cast<uintptr_t>(memory.get());
+        return memory.get() + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+    }
+
+    std::vector<Client*> clients;
+    std::vector<Region> regions;
+    juce::HeapBlock<char> memory;
+    size_t capacity = 0;
+    double highestSampleRate = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE(DelayArena)
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayArena.h"
+#include "BlockSmoother.h"
+
+/**
+*   Feedback delay network reverb with NumLines lines (8 or 16).
+*
+*   Every line shares one ring position and one power-of-two ring size, so a tap is a
+*   single masked index per line. Per sample, the tapped values go through a one-pole
+*   damping filter and a per-line decay gain, then a Householder matrix (x - 2/N * sum x)
+*   feeds them back. Everything after the taps runs on SIMDRegister lanes; Householder
+*   only needs one horizontal sum, where a Hadamard stage would need cross-lane shuffles.
+*
+*   Takes juce::dsp::Reverb::Parameters so it can stand in for the Freeverb engine:
+*   roomSize sets the decay time, damping the filter, wet/dry/width the output.
+*/
+template <typename SampleType, int NumLines>
+class FDNReverb : public DelayArena::Client
+{
+public:
+    static_assert(NumLines == 8 || NumLines == 16, "FDNReverb supports 8 or 16 lines");
+
+    using Parameters = juce::dsp::Reverb::Parameters;
+
+    void prepare(DelayArena& arena, const juce::dsp::ProcessSpec& spec)
+    {
+        preparedRate = spec.sampleRate;
+        data = nullptr;
+        wetGain.prepare(static_cast<int>(spec.maximumBlockSize));
+        dryGain.prepare(static_cast<int>(spec.maximumBlockSize));
+        inputLevel.prepare(static_cast<int>(spec.maximumBlockSize));
+        applyRate(spec.sampleRate);
+
+        arena.add(*this);
+    }
+
+    // Audio thread. Shorter lines inside the same rings, for rates at or below the prepared one.
+    void setProcessingRate(double rate)
+    {
+        jassert(rate <= preparedRate);
+        applyRate(juce::jmin(rate, preparedRate));
+        reset();
+    }
+
+    void reset()
+    {
+        if (data != nullptr)
+            std::fill(data, data + frames * NumLines, SampleType(0));
+
+        std::fill(std::begin(lowpass.values), std::end(lowpass.values), SampleType(0));
+        pos = 0;
+    }
+
+    [[nodiscard]] const Parameters& getParameters() const { return parameters; }
+
+    void setParameters(const Parameters& newParameters)
+    {
+        parameters = newParameters;
+
+        // Same output scaling as juce::Reverb, so switching engines keeps the levels
+        const auto wet = static_cast<SampleType>(parameters.wetLevel * wetScaleFactor);
+        wetGain.setTargetValue(wet);
+        dryGain.setTargetValue(static_cast<SampleType>(parameters.dryLevel * dryScaleFactor));
+        wet1 = static_cast<SampleType>(0.5f * (1.0f + parameters.width));
+        wet2 = static_cast<SampleType>(0.5f * (1.0f - parameters.width));
+
+        // Freeze stops feeding the tail as well, or input would pile up in a lossless loop
+        inputLevel.setTargetValue(parameters.freezeMode >= 0.5f ? SampleType(0) : inputGain);
+
+        const auto rt60 = parameters.freezeMode >= 0.5f ? 0.0
+                                                        : minRT60 * std::pow(maxRT60 / minRT60, static_cast<double>(parameters.roomSize));
+        const auto damp = static_cast<SampleType>(parameters.damping * maxDamping);
+
+        for (int l = 0; l < NumLines; ++l)
+        {
+            // -60 dB after rt60 seconds; freeze holds the tail at unity
+            decay.values[l] = rt60 > 0.0 ? static_cast<SampleType>(std::pow(10.0, -3.0 * lengths[static_cast<size_t>(l)] / (rt60 * sampleRate)))
+                                         : SampleType(1);
+            damping.values[l] = parameters.freezeMode >= 0.5f ? SampleType(0) : damp;
+        }
+    }
+
+    // wetScale, if given, is a per-sample gain on the wet signal only
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context, const SampleType* wetScale = nullptr)
+    {
+        auto& block = context.getOutputBlock();
+        const auto numChannels = block.getNumChannels();
+        const auto numSamples = static_cast<int>(block.getNumSamples());
+
+        if (data == nullptr || numChannels == 0)
+            return;
+
+        auto* left  = block.getChannelPointer(0);
+        auto* right = numChannels > 1 ? block.getChannelPointer(1) : nullptr;
+        const auto wetGains = wetGain.next(numSamples);
+        const auto dryGains = dryGain.next(numSamples);
+        const auto inputGains = inputLevel.next(numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto inL = left[i];
+            const auto inR = right != nullptr ? right[i] : inL;
+            const auto gain = inputGains[i];
+
+            tick((inL + inR) * gain, (inL - inR) * gain);
+
+            const auto wet = wetScale != nullptr ? wetGains[i] * wetScale[i] : wetGains[i];
+            const auto dry = dryGains[i];
+
+            if (right != nullptr)
+            {
+                left[i]  = (outL * wet1 + outR * wet2) * wet + inL * dry;
+                right[i] = (outR * wet1 + outL * wet2) * wet + inR * dry;
+            }
+            else
+            {
+                left[i] = (outL + outR) * SampleType(0.5) * wet + inL * dry;
+            }
+        }
+    }
+
+    [[nodiscard]] size_t getRequiredFrames(double rate) const override
+    {
+        const auto longest = baseLengths[NumLines - 1];
+        return static_cast<size_t>(std::ceil(longest * rate / 44100.0)) + 1;
+    }
+
+    [[nodiscard]] size_t getBytesPerFrame() const override { return sizeof(SampleType) * NumLines; }
+
+    void bindMemory(char* memory, size_t newFrames) override
+    {
+        data = reinterpret_cast<SampleType*>(memory);
+        frames = newFrames;
+        mask = static_cast<int>(newFrames) - 1;
+        reset();
+    }
+
+private:
+    using Vec = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr int lanes = static_cast<int>(Vec::SIMDNumElements);
+    static constexpr int groups = NumLines / lanes;
+
+    void applyRate(double rate)
+    {
+        sampleRate = rate;
+
+        const auto scale = sampleRate / 44100.0;
+        for (int l = 0; l < NumLines; ++l)
+            lengths[static_cast<size_t>(l)] = juce::jmax(1, static_cast<int>(baseLengths[static_cast<size_t>(l)] * scale));
+
+        setParameters(parameters);
+        wetGain.reset(sampleRate, 0.01);
+        dryGain.reset(sampleRate, 0.01);
+        inputLevel.reset(sampleRate, 0.01);
+    }
+
+    struct alignas(32) Lanes
+    {
+        SampleType values[NumLines] {};
+        SampleType* operator+(int offset) { return values + offset; }
+    };
+
+    void tick(SampleType input, SampleType side)
+    {
+        for (int l = 0; l < NumLines; ++l)
+            taps.values[l] = data[static_cast<size_t>(l) * frames + static_cast<size_t>((pos - lengths[static_cast<size_t>(l)]) & mask)];
+
+        auto sum = Vec::expand(0), left = Vec::expand(0), right = Vec::expand(0);
+
+        for (int g = 0; g < groups; ++g)
+        {
+            const auto offset = g * lanes;
+            const auto x  = Vec::fromRawArray(taps + offset);
+            auto filtered = Vec::fromRawArray(lowpass + offset);
+
+            filtered = x + (filtered - x) * Vec::fromRawArray(damping + offset);
+            filtered.copyToRawArray(lowpass + offset);
+
+            const auto y = filtered * Vec::fromRawArray(decay + offset);
+            y.copyToRawArray(taps + offset);
+            sum += y;
+
+            left  += filtered * Vec::fromRawArray(outputSignsL + offset);
+            right += filtered * Vec::fromRawArray(outputSignsR + offset);
+        }
+
+        const auto reflection = Vec::expand(sum.sum() * householderScale);
+        const auto mid = Vec::expand(input);
+        const auto sideIn = Vec::expand(side);
+
+        for (int g = 0; g < groups; ++g)
+        {
+            const auto offset = g * lanes;
+            const auto y = Vec::fromRawArray(taps + offset) + reflection
+                         + mid * Vec::fromRawArray(inputSigns + offset)
+                         + sideIn * Vec::fromRawArray(outputSignsL + offset);
+            y.copyToRawArray(taps + offset);
+        }
+
+        for (int l = 0; l < NumLines; ++l)
+            data[static_cast<size_t>(l) * frames + static_cast<size_t>(pos)] = taps.values[l];
+
+        pos = (pos + 1) & mask;
+        outL = left.sum() * outputGain;
+        outR = right.sum() * outputGain;
+    }
+
+    static constexpr SampleType householderScale = SampleType(-2) / SampleType(NumLines);
+    static constexpr float wetScaleFactor = 3.0f, dryScaleFactor = 2.0f;
+    static constexpr double minRT60 = 0.3, maxRT60 = 12.0;
+    static constexpr float maxDamping = 0.7f;
+
+    // Input gain as in Freeverb; output gain matches its wet level on noise at room 0.6, damping 0.5
+    static constexpr SampleType inputGain = SampleType(0.015);
+    static constexpr SampleType outputGain = NumLines == 8 ? SampleType(4.9) : SampleType(3.5);
+
+    // Mutually prime lengths at 44.1 kHz, ascending, 24-68 ms
+    static constexpr std::array<int, 16> baseLengths {
+        1051, 1171, 1307, 1453, 1579, 1693, 1861, 1999,
+        2113, 2239, 2377, 2503, 2659, 2791, 2903, 2999
+    };
+
+    static Lanes makeSigns(uint32_t pattern)
+    {
+        Lanes signs;
+        for (int l = 0; l < NumLines; ++l)
+            signs.values[l] = ((pattern >> l) & 1u) != 0 ? SampleType(-1) : SampleType(1);
+        return signs;
+    }
+
+    // Input spread and two decorrelated output taps, as Hadamard-style sign rows
+    Lanes inputSigns   = makeSigns(0x6996u);
+    Lanes outputSignsL = makeSigns(0x5a5au);
+    Lanes outputSignsR = makeSigns(0x3c3cu);
+
+    Lanes taps, lowpass, decay, damping;
+    std::array<int, NumLines> lengths {};
+
+    SampleType* data = nullptr;
+    size_t frames = 0;
+    int mask = 0, pos = 0;
+    double sampleRate = 44100.0, preparedRate = 44100.0;
+
+    Parameters parameters;
+    SampleType wet1 = 1, wet2 = 0, outL = 0, outR = 0;
+    BlockSmoother<SampleType> wetGain, dryGain, inputLevel { inputGain };
+};
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+*   Runs a processing core at 1/2 or 1/4 of the host rate, behind polyphase half-band
+*   decimators and interpolators (one stage per halving).
+*
+*   The half-band FIR has every other tap at zero, so split into even and odd phases one
+*   phase is a single centre tap and the other holds all the rest. The dense phase is also
+*   symmetric, so each pair of taps costs one multiply. It runs over tiles of outputs
+*   held in registers, a plain loop per tap that the compiler vectorises.
+*
+*   At a quarter rate the outer stage only has to keep out what would fold into the inner
+*   stage's passband, so it gets a much wider transition band and a filter half as long.
+*
+*   Host blocks that aren't a multiple of the factor are handled by carrying the last few
+*   input samples over to the next block, which costs factor - 1 samples of extra latency.
+*   getLatencySamples() includes that and both filter delays, and getDelayedInput() gives
+*   the input held back by the same amount, for mixing a dry path back in.
+*/
+template <typename SampleType>
+class HalfBandResampler
+{
+public:
+    static constexpr int maxFactor = 4;
+
+    HalfBandResampler()
+    {
+        // About 80 dB down from 0.3 of the higher rate
+        design(halfTaps, 8.0, dense.data(), centre);
+        // About 80 dB down from 0.35 of the higher rate, for a band that ends at 0.1
+        design(outerHalfTaps, 8.0, outerDense.data(), outerCentre);
+    }
+
+    // Message thread. Sized for the largest factor, so setFactor() never allocates.
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        numChannels = static_cast<int>(spec.numChannels);
+        const auto capacity = static_cast<int>(spec.maximumBlockSize) + maxFactor;
+
+        input.setSize(numChannels, capacity);
+        output.setSize(numChannels, capacity + maxFactor);
+        delayedInput.setSize(numChannels, getLatencySamples(maxFactor) + capacity);
+        scratch.resize(static_cast<size_t>(capacity));
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            const auto stageSize = capacity >> (s + 1);
+            lowRate[static_cast<size_t>(s)].setSize(numChannels, stageSize);
+            downEven[static_cast<size_t>(s)].setSize(numChannels, denseTaps - 1 + stageSize);
+            downOdd[static_cast<size_t>(s)].setSize(numChannels, halfTaps + stageSize);
+            upHistory[static_cast<size_t>(s)].setSize(numChannels, denseTaps - 1 + stageSize);
+        }
+
+        reset();
+    }
+
+    void reset()
+    {
+        for (int s = 0; s < numStages; ++s)
+        {
+            downEven[static_cast<size_t>(s)].clear();
+            downOdd[static_cast<size_t>(s)].clear();
+            upHistory[static_cast<size_t>(s)].clear();
+        }
+
+        output.clear();
+        delayedInput.clear();
+        inputFill = 0;
+        outputFill = factor - 1;
+        consumedDelayedInput = 0;
+    }
+
+    // Audio thread. 1, 2 or 4; clears the filters.
+    void setFactor(int newFactor)
+    {
+        jassert(newFactor == 1 || newFactor == 2 || newFactor == maxFactor);
+        factor = newFactor;
+        reset();
+    }
+
+    [[nodiscard]] int getFactor() const { return factor; }
+
+    static int getLatencySamples(int forFactor)
+    {
+        // Each stage delays by its filter's centre index on the way down and again on the way up
+        constexpr int stageDelay = 2 * (2 * halfTaps - 1);
+        constexpr int outerStageDelay = 2 * (2 * outerHalfTaps - 1);
+        return forFactor == 1 ? 0
+             : forFactor == 2 ? stageDelay + 1
+                              : outerStageDelay + 2 * stageDelay + 3;
+    }
+
+    [[nodiscard]] int getLatencySamples() const { return getLatencySamples(factor); }
+
+    // The input of the last processed block, getLatencySamples() late
+    [[nodiscard]] const SampleType* getDelayedInput(int channel) const { return delayedInput.getReadPointer(channel); }
+
+    /** Calls core with a block at host rate / factor and replaces block with its upsampled output. */
+    template <typename Core>
+    void process(juce::dsp::AudioBlock<SampleType>& block, Core&& core)
+    {
+        if (factor == 1)
+        {
+            core(block);
+            return;
+        }
+
+        const auto channels = juce::jmin(numChannels, static_cast<int>(block.getNumChannels()));
+        const auto numSamples = static_cast<int>(block.getNumSamples());
+        const auto stages = factor == maxFactor ? 2 : 1;
+
+        const auto total = inputFill + numSamples;
+        const auto usable = total - total % factor;
+        const auto lowSamples = usable / factor;
+        const auto latency = getLatencySamples();
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            auto* delayed = delayedInput.getWritePointer(ch);
+            std::copy(delayed + consumedDelayedInput, delayed + consumedDelayedInput + latency, delayed);
+            juce::FloatVectorOperations::copy(delayed + latency, block.getChannelPointer(static_cast<size_t>(ch)), numSamples);
+
+            juce::FloatVectorOperations::copy(input.getWritePointer(ch) + inputFill,
+                                              block.getChannelPointer(static_cast<size_t>(ch)), numSamples);
+
+            const SampleType* source = input.getReadPointer(ch);
+            for (int s = 0, n = usable / 2; s < stages; ++s, n /= 2)
+            {
+                decimate(s, ch, source, lowRate[static_cast<size_t>(s)].getWritePointer(ch), n);
+                source = lowRate[static_cast<size_t>(s)].getReadPointer(ch);
+            }
+        }
+
+        if (lowSamples > 0)
+        {
+            juce::dsp::AudioBlock<SampleType> low(lowRate[static_cast<size_t>(stages - 1)]);
+            auto lowBlock = low.getSubsetChannelBlock(0, static_cast<size_t>(channels))
+                               .getSubBlock(0, static_cast<size_t>(lowSamples));
+            core(lowBlock);
+        }
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            for (int s = stages - 1, n = lowSamples; s >= 0; --s, n *= 2)
+            {
+                auto* destination = s == 0 ? output.getWritePointer(ch) + outputFill
+                                           : lowRate[static_cast<size_t>(s - 1)].getWritePointer(ch);
+                interpolate(s, ch, lowRate[static_cast<size_t>(s)].getReadPointer(ch), destination, n);
+            }
+
+            auto* in = input.getWritePointer(ch);
+            std::copy(in + usable, in + total, in);
+
+            auto* out = output.getWritePointer(ch);
+            juce::FloatVectorOperations::copy(block.getChannelPointer(static_cast<size_t>(ch)), out, numSamples);
+            std::copy(out + numSamples, out + outputFill + usable, out);
+        }
+
+        inputFill = total - usable;
+        outputFill += usable - numSamples;
+        consumedDelayedInput = numSamples;
+    }
+
+private:
+    static constexpr int halfTaps = 12;                 // filter length 4 * halfTaps - 1
+    static constexpr int denseTaps = 2 * halfTaps;
+    static constexpr int outerHalfTaps = 6;
+    static constexpr int numStages = 2;
+
+    // Kaiser-windowed half-band lowpass, kept as its dense phase and centre tap
+    static void design(int numHalfTaps, double beta, SampleType* denseOut, SampleType& centreOut)
+    {
+        const int length = 4 * numHalfTaps - 1;
+        const int centreIndex = length / 2;
+
+        std::vector<double> h(static_cast<size_t>(length));
+        double sum = 0.0;
+
+        for (int k = 0; k < length; ++k)
+        {
+            const auto x = k - centreIndex;
+            const auto t = 2.0 * k / (length - 1) - 1.0;
+            const auto window = besselI0(beta * std::sqrt(1.0 - t * t)) / besselI0(beta);
+
+            h[static_cast<size_t>(k)] = x == 0 ? 0.5
+                                      : x % 2 == 0 ? 0.0
+                                      : std::sin(juce::MathConstants<double>::halfPi * x) / (juce::MathConstants<double>::pi * x) * window;
+            sum += h[static_cast<size_t>(k)];
+        }
+
+        for (int j = 0; j < 2 * numHalfTaps; ++j)
+            denseOut[j] = static_cast<SampleType>(h[static_cast<size_t>(2 * j)] / sum);
+
+        centreOut = static_cast<SampleType>(h[static_cast<size_t>(centreIndex)] / sum);
+    }
+
+    [[nodiscard]] bool isOuterStage(int stage) const { return factor == maxFactor && stage == 0; }
+
+    static double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // out[m] = sum_j taps[j] * src[m - j], with 2 * Half - 1 samples of history before src
+    template <int Half>
+    static void denseFilter(const SampleType* taps, const SampleType* src, SampleType* out, int n)
+    {
+        constexpr int tile = 16;
+        int m = 0;
+
+        for (; m + tile <= n; m += tile)
+        {
+            SampleType acc[tile] {};
+
+            for (int j = 0; j < Half; ++j)
+            {
+                const auto coefficient = taps[j];
+                const auto* near = src + m - j;
+                const auto* far  = src + m - (2 * Half - 1) + j;
+
+                for (int t = 0; t < tile; ++t)
+                    acc[t] += coefficient * (near[t] + far[t]);
+            }
+
+            std::copy(acc, acc + tile, out + m);
+        }
+
+        for (; m < n; ++m)
+        {
+            SampleType acc = 0;
+            for (int j = 0; j < Half; ++j)
+                acc += taps[j] * (src[m - j] + src[m - (2 * Half - 1) + j]);
+            out[m] = acc;
+        }
+    }
+
+    void denseFilter(int stage, const SampleType* src, SampleType* out, int n) const
+    {
+        if (isOuterStage(stage))
+            denseFilter<outerHalfTaps>(outerDense.data(), src, out, n);
+        else
+            denseFilter<halfTaps>(dense.data(), src, out, n);
+    }
+
+    // 2n samples in, n out:  out[m] = centre * odd[m - halfTaps] + sum_j dense[j] * even[m - j]
+    void decimate(int stage, int ch, const SampleType* in, SampleType* out, int n)
+    {
+        auto* even = downEven[static_cast<size_t>(stage)].getWritePointer(ch);
+        auto* odd  = downOdd[static_cast<size_t>(stage)].getWritePointer(ch);
+        const auto taps = isOuterStage(stage) ? outerHalfTaps : halfTaps;
+        const auto evenHistory = 2 * taps - 1, oddHistory = taps;
+
+        for (int i = 0; i < n; ++i)
+        {
+            even[evenHistory + i] = in[2 * i];
+            odd[oddHistory + i]   = in[2 * i + 1];
+        }
+
+        denseFilter(stage, even + evenHistory, out, n);
+        juce::FloatVectorOperations::addWithMultiply(out, odd, isOuterStage(stage) ? outerCentre : centre, n);
+
+        std::copy(even + n, even + n + evenHistory, even);
+        std::copy(odd + n, odd + n + oddHistory, odd);
+    }
+
+    // n samples in, 2n out:  even outputs take the dense phase, odd ones the centre tap
+    void interpolate(int stage, int ch, const SampleType* in, SampleType* out, int n)
+    {
+        auto* history = upHistory[static_cast<size_t>(stage)].getWritePointer(ch);
+        const auto taps = isOuterStage(stage) ? outerHalfTaps : halfTaps;
+        const auto historySize = 2 * taps - 1;
+        const auto oddGain = SampleType(2) * (isOuterStage(stage) ? outerCentre : centre);
+
+        juce::FloatVectorOperations::copy(history + historySize, in, n);
+
+        auto* evens = scratch.data();
+        denseFilter(stage, history + historySize, evens, n);
+
+        // Zero-stuffing halves the level, so both phases are doubled
+        const auto oddSource = history + historySize - (taps - 1);
+        for (int m = 0; m < n; ++m)
+        {
+            out[2 * m]     = SampleType(2) * evens[m];
+            out[2 * m + 1] = oddGain * oddSource[m];
+        }
+
+        std::copy(history + n, history + n + historySize, history);
+    }
+
+    std::array<SampleType, denseTaps> dense {};
+    std::array<SampleType, 2 * outerHalfTaps> outerDense {};
+    SampleType centre = SampleType(0.5), outerCentre = SampleType(0.5);
+
+    int numChannels = 0;
+    int factor = 1;
+    int inputFill = 0, outputFill = 0, consumedDelayedInput = 0;
+
+    juce::AudioBuffer<SampleType> input, output, delayedInput;
+    std::array<juce::AudioBuffer<SampleType>, numStages> lowRate, downEven, downOdd, upHistory;
+    std::vector<SampleType> scratch;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PartitionedConvolver.h"
+
+/**
+*   Process-wide store of convolution kernels, so every instance that loads the same
+*   impulse response shares one set of partition spectra.
+*
+*   Files are read through memory mappings: WAV and AIFF through JUCE's memory-mapped
+*   readers, compressed formats such as FLAC by decoding straight out of the mapped bytes.
+*   The mapped bytes are also hashed, so the same response under another path, or a file
+*   rewritten in place, is keyed by what it contains rather than where it lives.
+*
+*   Kernels are keyed by (file hash, sample rate, partition size). The cache only holds
+*   weak references: a kernel is freed when the last convolver using it lets go.
+*/
+template <typename SampleType>
+class ImpulseResponseLibrary
+{
+public:
+    using Kernel = typename PartitionedConvolver<SampleType>::Kernel;
+
+    ImpulseResponseLibrary() { formats.registerBasicFormats(); }
+
+    /** Message thread. Returns nullptr if the file can't be read. */
+    std::shared_ptr<const Kernel> getKernel(const juce::File& file, double sampleRate,
+                                            int partitionSize, int maxPartitions)
+    {
+        juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+        if (mapped.getData() == nullptr || mapped.getSize() == 0)
+            return nullptr;
+
+        const Key key { hashBytes(mapped.getData(), mapped.getSize()), sampleRate, partitionSize };
+
+        // Held while building, so instances restoring the same session don't decode it twice
+        const juce::ScopedLock sl(lock);
+        pruneExpired();
+
+        if (auto found = cache.find(key); found != cache.end())
+            if (auto kernel = found->second.lock())
+                return kernel;
+
+        double fileSampleRate = 0.0;
+        const auto impulse = decode(file, mapped, fileSampleRate);
+        if (impulse.getNumSamples() == 0)
+            return nullptr;
+
+        const auto conformed = conform(impulse, fileSampleRate, sampleRate, maxPartitions * partitionSize);
+        auto kernel = PartitionedConvolver<SampleType>::makeKernel(conformed, partitionSize, maxPartitions);
+        cache[key] = kernel;
+        return kernel;
+    }
+
+    // Kernels still alive in the cache, for diagnostics
+    [[nodiscard]] int getNumCachedKernels()
+    {
+        const juce::ScopedLock sl(lock);
+        pruneExpired();
+        return static_cast<int>(cache.size());
+    }
+
+    /**
+    *   Resampled to the session rate, cut to maxLength samples and normalised to unit
+    *   energy per channel on average, so the wet level doesn't depend on the file.
+    */
+    static juce::AudioBuffer<float> conform(const juce::AudioBuffer<float>& impulse, double impulseSampleRate,
+                                            double sampleRate, int maxLength)
+    {
+        const auto ratio = impulseSampleRate / sampleRate;
+        const auto inLength = impulse.getNumSamples();
+        const auto outLength = juce::jmin(static_cast<int>(std::ceil(inLength / ratio)), maxLength);
+
+        juce::AudioBuffer<float> out(impulse.getNumChannels(), outLength);
+        double energy = 0.0;
+
+        for (int ch = 0; ch < out.getNumChannels(); ++ch)
+        {
+            if (juce::approximatelyEqual(ratio, 1.0))
+            {
+                out.copyFrom(ch, 0, impulse, ch, 0, outLength);
+            }
+            else
+            {
+                juce::LagrangeInterpolator interpolator;
+                out.clear(ch, 0, outLength);
+                interpolator.process(ratio, impulse.getReadPointer(ch), out.getWritePointer(ch),
+                                     outLength, inLength, 0);
+            }
+
+            const auto* samples = out.getReadPointer(ch);
+            for (int i = 0; i < outLength; ++i)
+                energy += static_cast<double>(samples[i]) * samples[i];
+        }
+
+        if (energy > 0.0)
+            out.applyGain(static_cast<float>(1.0 / std::sqrt(energy / out.getNumChannels())));
+
+        return out;
+    }
+
+private:
+    struct Key
+    {
+        uint64_t fileHash;
+        double sampleRate;
+        int partitionSize;
+
+        bool operator<(const Key& other) const
+        {
+            return std::tie(fileHash, sampleRate, partitionSize)
+                 < std::tie(other.fileHash, other.sampleRate, other.partitionSize);
+        }
+    };
+
+    // 64-bit FNV-1a; only has to tell impulse responses apart, not resist tampering
+    static uint64_t hashBytes(const void* data, size_t size)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = 14695981039346656037ull;
+
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+        return hash;
+    }
+
+    juce::AudioBuffer<float> decode(const juce::File& file, const juce::MemoryMappedFile& mapped, double& fileSampleRate)
+    {
+        juce::AudioBuffer<float> buffer;
+        auto* format = formats.findFormatForFileExtension(file.getFileExtension());
+        if (format == nullptr)
+            return buffer;
+
+        // Uncompressed formats read their samples straight out of the mapping
+        if (std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader { format->createMemoryMappedReader(file) })
+        {
+            if (reader->mapEntireFile())
+                read(*reader, buffer, fileSampleRate);
+            return buffer;
+        }
+
+        // Compressed ones decode from the mapped bytes, without a copy of the file on the heap
+        auto stream = std::make_unique<juce::MemoryInputStream>(mapped.getData(), mapped.getSize(), false);
+        if (std::unique_ptr<juce::AudioFormatReader> reader { format->createReaderFor(stream.release(), true) })
+            read(*reader, buffer, fileSampleRate);
+
+        return buffer;
+    }
+
+    static void read(juce::AudioFormatReader& reader, juce::AudioBuffer<float>& buffer, double& fileSampleRate)
+    {
+        const auto length = static_cast<int>(reader.lengthInSamples);
+        buffer.setSize(static_cast<int>(reader.numChannels), length);
+        reader.read(&buffer, 0, length, 0, true, true);
+        fileSampleRate = reader.sampleRate;
+    }
+
+    void pruneExpired()
+    {
+        for (auto it = cache.begin(); it != cache.end();)
+            it = it->second.expired() ? cache.erase(it) : std::next(it);
+    }
+
+    juce::CriticalSection lock;
+    juce::AudioFormatManager formats;
+    std::map<Key, std::weak_ptr<const Kernel>> cache;
+};
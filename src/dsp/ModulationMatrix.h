@@ -0,0 +1,221 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BlockSmoother.h"
+
+/**
+*   LFOs, envelope followers and random walks routed onto effect parameters.
+*
+*   Sources are stepped once per control interval, not per sample. For each parameter
+*   with a route on it, the control points are joined by linear ramps into one offset
+*   buffer per block, and the parameter's BlockSmoother adds that buffer on top of its own
+*   smoothing. Parameters with no route cost nothing.
+*
+*   Effects register the smoothers they want modulated from prepare(), as they register
+*   delay lines with the DelayArena. A route's depth is in [-1, 1], scaled by the range
+*   the effect registered the parameter with.
+*/
+template <typename SampleType>
+class ModulationMatrix
+{
+public:
+    enum class Source { Off, LFO1, LFO2, InputEnvelope, SidechainEnvelope, Random1, Random2, numSources };
+
+    enum class Destination { DelayTime, DelayFeedback, FlangerDelay, FlangerDepth, FlangerFeedback, ReverbWet, numDestinations };
+
+    enum class LFOShape { Sine, Triangle };
+
+    static constexpr int maxRoutes = 4;
+
+    // Message thread, before the effects' prepare(), which register their parameters again
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+
+        for (auto& destination : destinations)
+        {
+            destination.smoother = nullptr;
+            destination.offsets.resize(static_cast<size_t>(spec.maximumBlockSize));
+        }
+
+        reset();
+    }
+
+    void reset()
+    {
+        lfoPhases.fill(0.0);
+        envelopes.fill(SampleType(0));
+        randomValues.fill(SampleType(0));
+
+        for (auto& destination : destinations)
+            destination.lastOffset = SampleType(0);
+    }
+
+    /** Message thread, from an effect's prepare(). Offsets are range * depth, clamped to [lowest, highest]. */
+    void addDestination(Destination which, BlockSmoother<SampleType>& smoother,
+                        SampleType range, SampleType lowest, SampleType highest)
+    {
+        auto& destination = destinations[static_cast<size_t>(which)];
+        destination.smoother = &smoother;
+        destination.range = range;
+        destination.lowest = lowest;
+        destination.highest = highest;
+    }
+
+    // Audio thread, like the rest of the settings below
+    void setRoute(int slot, Source source, Destination destination, float depth)
+    {
+        jassert(juce::isPositiveAndBelow(slot, maxRoutes));
+        routes[static_cast<size_t>(slot)] = { source, destination, static_cast<SampleType>(juce::jlimit(-1.0f, 1.0f, depth)) };
+    }
+
+    void setControlInterval(int samples) { controlInterval = juce::jmax(1, samples); }
+    [[nodiscard]] int getControlInterval() const { return controlInterval; }
+
+    void setLFO(int index, float rateHz, LFOShape shape)
+    {
+        lfoRates[static_cast<size_t>(index)] = rateHz;
+        lfoShapes[static_cast<size_t>(index)] = shape;
+    }
+
+    void setRandomRate(float rateHz) { randomRate = rateHz; }
+
+    /** Audio thread. Steps the sources over the block and hands each routed parameter its offsets. */
+    void process(const juce::dsp::AudioBlock<const SampleType>& input,
+                 const juce::dsp::AudioBlock<const SampleType>& sidechain, int numSamples)
+    {
+        // A parameter whose last route went away ramps back to its own value first
+        std::array<bool, numDestinations> routed {};
+        for (size_t d = 0; d < destinations.size(); ++d)
+            routed[d] = destinations[d].smoother != nullptr && destinations[d].lastOffset != SampleType(0);
+
+        for (const auto& route : routes)
+            if (route.source != Source::Off && route.depth != SampleType(0)
+                && destinations[static_cast<size_t>(route.destination)].smoother != nullptr)
+                routed[static_cast<size_t>(route.destination)] = true;
+
+        for (int start = 0; start < numSamples; start += controlInterval)
+        {
+            const auto length = juce::jmin(controlInterval, numSamples - start);
+            stepSources(input, sidechain, start, length);
+
+            for (size_t d = 0; d < destinations.size(); ++d)
+            {
+                if (!routed[d])
+                    continue;
+
+                auto& destination = destinations[d];
+                SampleType target = 0;
+
+                for (const auto& route : routes)
+                    if (static_cast<size_t>(route.destination) == d && route.source != Source::Off)
+                        target += route.depth * sources[static_cast<size_t>(route.source)];
+
+                target *= destination.range;
+
+                // Linear from the previous control point, as the ducker's gains are
+                const auto increment = (target - destination.lastOffset) / static_cast<SampleType>(length);
+                auto* ramp = destination.offsets.data() + start;
+                for (int i = 0; i < length; ++i)
+                    ramp[i] = destination.lastOffset + increment * static_cast<SampleType>(i + 1);
+
+                destination.lastOffset = target;
+            }
+        }
+
+        for (size_t d = 0; d < destinations.size(); ++d)
+        {
+            auto& destination = destinations[d];
+            if (destination.smoother == nullptr)
+                continue;
+
+            if (routed[d])
+            {
+                destination.smoother->setModulation(destination.offsets.data(), destination.lowest, destination.highest);
+            }
+            else
+            {
+                destination.smoother->setModulation(nullptr, 0, 0);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t numDestinations = static_cast<size_t>(Destination::numDestinations);
+    static constexpr SampleType envelopeAttackSeconds = SampleType(0.01), envelopeReleaseSeconds = SampleType(0.25);
+
+    struct Route
+    {
+        Source source = Source::Off;
+        Destination destination = Destination::DelayTime;
+        SampleType depth = 0;
+    };
+
+    struct Target
+    {
+        BlockSmoother<SampleType>* smoother = nullptr;
+        SampleType range = 0, lowest = 0, highest = 0, lastOffset = 0;
+        std::vector<SampleType> offsets;
+    };
+
+    // LFOs and random walks are bipolar, envelopes run from 0 to 1
+    void stepSources(const juce::dsp::AudioBlock<const SampleType>& input,
+                     const juce::dsp::AudioBlock<const SampleType>& sidechain, int start, int length)
+    {
+        const auto seconds = length / sampleRate;
+
+        for (size_t l = 0; l < lfoPhases.size(); ++l)
+        {
+            auto& phase = lfoPhases[l];
+            phase += lfoRates[l] * seconds;
+            phase -= std::floor(phase);
+
+            sources[static_cast<size_t>(Source::LFO1) + l] = static_cast<SampleType>(
+                lfoShapes[l] == LFOShape::Sine ? std::sin(juce::MathConstants<double>::twoPi * phase)
+                                               : 1.0 - 4.0 * std::abs(phase - 0.5));
+        }
+
+        const juce::dsp::AudioBlock<const SampleType>* followed[] = { &input, &sidechain };
+        for (size_t e = 0; e < envelopes.size(); ++e)
+        {
+            SampleType peak = 0;
+            for (size_t ch = 0; ch < followed[e]->getNumChannels(); ++ch)
+            {
+                const auto range = juce::FloatVectorOperations::findMinAndMax(followed[e]->getChannelPointer(ch) + start, length);
+                peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+            }
+
+            const auto time = peak > envelopes[e] ? envelopeAttackSeconds : envelopeReleaseSeconds;
+            const auto coefficient = static_cast<SampleType>(std::exp(-seconds / time));
+            envelopes[e] = peak + coefficient * (envelopes[e] - peak);
+
+            sources[static_cast<size_t>(Source::InputEnvelope) + e] = juce::jmin(envelopes[e], SampleType(1));
+        }
+
+        // Steps scale with the square root of time, so the rate doesn't depend on the interval
+        const auto stepSize = static_cast<SampleType>(std::sqrt(randomRate * seconds));
+        for (size_t r = 0; r < randomValues.size(); ++r)
+        {
+            auto value = randomValues[r] + stepSize * static_cast<SampleType>(2.0f * random.nextFloat() - 1.0f);
+            value = value > 1 ? 2 - value : value < -1 ? -2 - value : value;
+            randomValues[r] = value;
+
+            sources[static_cast<size_t>(Source::Random1) + r] = value;
+        }
+    }
+
+    double sampleRate = 44100.0;
+    int controlInterval = 32;
+
+    std::array<Route, maxRoutes> routes {};
+    std::array<Target, numDestinations> destinations;
+    std::array<SampleType, static_cast<size_t>(Source::numSources)> sources {};
+
+    std::array<double, 2> lfoPhases {};
+    std::array<float, 2> lfoRates { 0.5f, 2.0f };
+    std::array<LFOShape, 2> lfoShapes { LFOShape::Sine, LFOShape::Triangle };
+    std::array<SampleType, 2> envelopes {};
+    std::array<SampleType, 2> randomValues {};
+    float randomRate = 0.5f;
+    juce::Random random;
+};
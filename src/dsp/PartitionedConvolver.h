@@ -0,0 +1,532 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <fft.h>
+
+/**
+*   One background thread shared by every convolver in the process. It keeps looping over
+*   the registered convolvers while any of them has tail work ready, and sleeps otherwise.
+*/
+class ConvolutionTailWorker : private juce::Thread
+{
+public:
+    class Task
+    {
+    public:
+        virtual ~Task() = default;
+
+        // Computes at most one block of tail; returns false when there was nothing to do
+        virtual bool runTailWork() = 0;
+    };
+
+    ConvolutionTailWorker() : juce::Thread("Convolution tail")
+    {
+        startThread(juce::Thread::Priority::high);
+    }
+
+    ~ConvolutionTailWorker() override { stopThread(2000); }
+
+    // Message thread
+    void add(Task& task)
+    {
+        const juce::ScopedLock sl(lock);
+        tasks.push_back(&task);
+    }
+
+    // Message thread. Once this returns the worker is outside the task and won't enter it again.
+    void remove(Task& task)
+    {
+        {
+            const juce::ScopedLock sl(lock);
+            tasks.erase(std::remove(tasks.begin(), tasks.end(), &task), tasks.end());
+        }
+
+        // Waits out a runTailWork() already under way
+        const juce::ScopedLock running(runLock);
+    }
+
+    // Audio thread: a convolver has published new input
+    void wake() { workReady.signal(); }
+
+private:
+    // The list lock is only held to copy the list and to check a task is still on it, so add()
+    // never waits for tail work; runLock covers one task at a time, for remove() to wait on.
+    void run() override
+    {
+        std::vector<Task*> snapshot;
+
+        while (!threadShouldExit())
+        {
+            {
+                const juce::ScopedLock sl(lock);
+                snapshot = tasks;
+            }
+
+            bool busy = false;
+            for (auto* task : snapshot)
+            {
+                const juce::ScopedLock running(runLock);
+                if (!isListed(task))
+                    continue;
+
+                busy = task->runTailWork() || busy;
+            }
+
+            if (!busy)
+                workReady.wait(5.0);
+        }
+    }
+
+    bool isListed(Task* task)
+    {
+        const juce::ScopedLock sl(lock);
+        return std::find(tasks.begin(), tasks.end(), task) != tasks.end();
+    }
+
+    juce::CriticalSection lock, runLock;
+    std::vector<Task*> tasks;
+    juce::WaitableEvent workReady;
+};
+
+/**
+*   Uniformly partitioned FFT convolution (overlap-save), for impulse responses several
+*   seconds long.
+*
+*   The impulse response is cut into partitions of partitionSize samples, each kept as the
+*   spectrum of a 2 * partitionSize FFT. Every partitionSize input samples, one input
+*   spectrum goes into a ring (the frequency-domain delay line), and the output spectrum is
+*   the sum over partitions of  input[block - k] * impulse[k].
+*
+*   The first headPartitions terms are summed on the audio thread. The rest only needs
+*   input that is at least headPartitions blocks old, so the shared tail worker sums them
+*   as soon as that input exists and has headPartitions blocks to deliver the result.
+*   When it misses the deadline the audio thread sums the tail itself for that block.
+*
+*   Spectra are stored split, real parts then imaginary parts, so the multiply-accumulate
+*   runs on whole SIMDRegisters. Output lags the input by partitionSize samples.
+*/
+template <typename SampleType>
+class PartitionedConvolver : private ConvolutionTailWorker::Task
+{
+public:
+    // Partition spectra of one impulse response, shared read-only once built
+    struct Kernel
+    {
+        int partitionSize = 0;
+        int numPartitions = 0;
+        int numChannels = 0;
+
+        // Never reused, unlike the address, so a tail summed with a freed kernel can't pass for a new one's
+        uint64_t version = 0;
+
+        [[nodiscard]] SampleType* getPartition(int channel, int partition) const
+        {
+            return spectra + (static_cast<size_t>(channel) * static_cast<size_t>(numPartitions)
+                              + static_cast<size_t>(partition)) * static_cast<size_t>(2 * partitionSize);
+        }
+
+        juce::HeapBlock<char> memory;
+        SampleType* spectra = nullptr;
+    };
+
+    /** Message thread. The response must already be at the rate the convolver runs at. */
+    static std::shared_ptr<const Kernel> makeKernel(const juce::AudioBuffer<float>& impulse,
+                                                    int partitionSize, int maxPartitions)
+    {
+        const auto length = impulse.getNumSamples();
+        if (length == 0 || impulse.getNumChannels() == 0)
+            return nullptr;
+
+        auto kernel = std::make_shared<Kernel>();
+        kernel->version = ++kernelVersions;
+        kernel->partitionSize = partitionSize;
+        kernel->numChannels = impulse.getNumChannels();
+        kernel->numPartitions = juce::jmin(maxPartitions, (length + partitionSize - 1) / partitionSize);
+        kernel->spectra = allocateAligned(kernel->memory, static_cast<size_t>(kernel->numChannels * kernel->numPartitions)
+                                                          * static_cast<size_t>(2 * partitionSize));
+
+        signalsmith::linear::RealFFT<SampleType> fft(static_cast<size_t>(2 * partitionSize));
+        std::vector<SampleType> time(static_cast<size_t>(2 * partitionSize));
+        std::vector<Complex> freq(static_cast<size_t>(partitionSize));
+
+        // The inverse FFT is unscaled; its 1/N is folded into the partitions
+        const auto scale = SampleType(1) / static_cast<SampleType>(2 * partitionSize);
+
+        for (int ch = 0; ch < kernel->numChannels; ++ch)
+        {
+            const auto* source = impulse.getReadPointer(ch);
+
+            for (int k = 0; k < kernel->numPartitions; ++k)
+            {
+                const auto start = k * partitionSize;
+                const auto count = juce::jmin(partitionSize, length - start);
+
+                std::fill(time.begin(), time.end(), SampleType(0));
+                for (int i = 0; i < count; ++i)
+                    time[static_cast<size_t>(i)] = static_cast<SampleType>(source[start + i]) * scale;
+
+                fft.fft(time.data(), freq.data());
+                split(freq.data(), kernel->getPartition(ch, k), partitionSize);
+            }
+        }
+
+        return kernel;
+    }
+
+    PartitionedConvolver() = default;
+
+    ~PartitionedConvolver() override { worker->remove(*this); }
+
+    /** Message thread. Sizes everything for responses up to maxSeconds at this rate. */
+    void prepare(const juce::dsp::ProcessSpec& spec, int newPartitionSize, float maxSeconds)
+    {
+        jassert(juce::isPowerOfTwo(newPartitionSize) && newPartitionSize >= 2 * lanes);
+
+        // Nothing below may change while the worker is reading it
+        worker->remove(*this);
+
+        partitionSize = newPartitionSize;
+        numChannels = static_cast<int>(spec.numChannels);
+        maxPartitions = juce::jmax(1, static_cast<int>(std::ceil(maxSeconds * spec.sampleRate / partitionSize)));
+
+        // Enough head that a whole host block of partitions still leaves the worker a block of slack
+        const auto partitionsPerBlock = (static_cast<int>(spec.maximumBlockSize) + partitionSize - 1) / partitionSize;
+        headPartitions = juce::jmax(minHeadPartitions, 2 * partitionsPerBlock);
+
+        // A block's input overwrites the slot of the block ringSize back, which no sum still reads
+        ringSize = maxPartitions + 1;
+        numSlots = headPartitions + 1;
+
+        const auto spectrumSize = static_cast<size_t>(2 * partitionSize);
+        const auto frameSize = spectrumSize * static_cast<size_t>(numChannels);
+
+        inputFrames  = allocateAligned(inputMemory, frameSize);
+        outputFrames = allocateAligned(outputMemory, frameSize);
+        ring         = allocateAligned(ringMemory, frameSize * static_cast<size_t>(ringSize));
+        slotSpectra  = allocateAligned(slotMemory, frameSize * static_cast<size_t>(numSlots));
+        accumulator  = allocateAligned(accumulatorMemory, frameSize);
+        timeScratch  = allocateAligned(timeMemory, spectrumSize);
+
+        slots.reset(new Slot[static_cast<size_t>(numSlots)]);
+        fft.resize(spectrumSize);
+        freqScratch.resize(static_cast<size_t>(partitionSize));
+
+        block = 0;
+        nextTarget = 0;
+        reset();
+
+        worker->add(*this);
+    }
+
+    /** Message thread. Pass nullptr to unload; the old kernel is freed once neither the audio
+        thread nor the worker uses it. Never waits for either. */
+    void setKernel(std::shared_ptr<const Kernel> newKernel)
+    {
+        jassert(newKernel == nullptr || newKernel->partitionSize == partitionSize);
+
+        retired.push_back(std::move(kernel));
+        kernel = std::move(newKernel);
+        latestKernel.store(kernel.get());
+
+        const auto* audioInUse = audioKernel.load();
+        const auto* workerInUse = workerKernel.load();
+        retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                     [audioInUse, workerInUse](const auto& k)
+                                     { return k.get() != audioInUse && k.get() != workerInUse; }),
+                      retired.end());
+    }
+
+    [[nodiscard]] bool hasKernel() const { return latestKernel.load() != nullptr; }
+    [[nodiscard]] int getLatencySamples() const { return partitionSize; }
+    [[nodiscard]] int getPartitionSize() const { return partitionSize; }
+    [[nodiscard]] int getMaxPartitions() const { return maxPartitions; }
+
+    // Blocks where the worker was late and the audio thread summed the tail itself
+    [[nodiscard]] int getDeadlineMisses() const { return deadlineMisses.load(); }
+
+    // Audio thread, so the worker may still be reading the ring: it is left as it is, and
+    // sums from here on stop at the first block after the reset instead
+    void reset()
+    {
+        const auto frameSize = static_cast<size_t>(2 * partitionSize * numChannels);
+
+        if (inputFrames != nullptr)
+        {
+            std::fill(inputFrames, inputFrames + frameSize, SampleType(0));
+            std::fill(outputFrames, outputFrames + frameSize, SampleType(0));
+        }
+
+        fill = 0;
+
+        // Skip past every block the worker may still be summing, so none of it is used. Whole
+        // turns of the ring, so new input lands where the worker's reads already expect it.
+        block += (numSlots + ringSize - 1) / ringSize * ringSize;
+        historyStart.store(block, std::memory_order_relaxed);
+        published.store(block - 1, std::memory_order_release);
+        consumed.store(block - 1, std::memory_order_release);
+    }
+
+    /** Replaces the block with the wet signal. Without a kernel the output is silent. */
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context)
+    {
+        auto& output = context.getOutputBlock();
+        const auto channels = juce::jmin(numChannels, static_cast<int>(output.getNumChannels()));
+        const auto numSamples = static_cast<int>(output.getNumSamples());
+
+        const auto* current = acquireKernel(audioKernel);
+        if (current == nullptr)
+        {
+            output.clear();
+            return;
+        }
+
+        int done = 0;
+        while (done < numSamples)
+        {
+            const auto run = juce::jmin(numSamples - done, partitionSize - fill);
+
+            for (int ch = 0; ch < channels; ++ch)
+            {
+                auto* samples = output.getChannelPointer(static_cast<size_t>(ch)) + done;
+                std::copy(samples, samples + run, inputFrame(ch) + partitionSize + fill);
+                std::copy(outputFrame(ch) + fill, outputFrame(ch) + fill + run, samples);
+            }
+
+            fill += run;
+            done += run;
+
+            if (fill == partitionSize)
+            {
+                processPartition(*current);
+                fill = 0;
+            }
+        }
+    }
+
+private:
+    using Complex = std::complex<SampleType>;
+    using Vec = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr int lanes = static_cast<int>(Vec::SIMDNumElements);
+    static constexpr size_t alignment = 64;
+    static constexpr int minHeadPartitions = 4;
+    static constexpr int tailCheckInterval = 32;   // tail partitions between deadline checks
+
+    struct Slot
+    {
+        std::atomic<int64_t> target { -1 };
+        uint64_t kernelVersion = 0;
+    };
+
+    static SampleType* allocateAligned(juce::HeapBlock<char>& memory, size_t count)
+    {
+        memory.allocate(count * sizeof(SampleType) + alignment, true);
+        const auto address = reinterpret_cast<uintptr_t>(memory.get());
+        return reinterpret_cast<SampleType*>(memory.get() + ((alignment - (address & (alignment - 1))) & (alignment - 1)));
+    }
+
+    static void split(const Complex* freq, SampleType* spectrum, int bins)
+    {
+        for (int i = 0; i < bins; ++i)
+        {
+            spectrum[i] = freq[i].real();
+            spectrum[bins + i] = freq[i].imag();
+        }
+    }
+
+    static void interleave(const SampleType* spectrum, Complex* freq, int bins)
+    {
+        for (int i = 0; i < bins; ++i)
+            freq[i] = { spectrum[i], spectrum[bins + i] };
+    }
+
+    // acc += x * h over split spectra
+    static void multiplyAccumulate(SampleType* acc, const SampleType* x, const SampleType* h, int bins)
+    {
+        // Bin 0 holds DC and Nyquist as two real values, not one complex one
+        const auto dc = acc[0] + x[0] * h[0];
+        const auto nyquist = acc[bins] + x[bins] * h[bins];
+
+        for (int i = 0; i < bins; i += lanes)
+        {
+            const auto xr = Vec::fromRawArray(x + i), xi = Vec::fromRawArray(x + bins + i);
+            const auto hr = Vec::fromRawArray(h + i), hi = Vec::fromRawArray(h + bins + i);
+
+            (Vec::fromRawArray(acc + i) + xr * hr - xi * hi).copyToRawArray(acc + i);
+            (Vec::fromRawArray(acc + bins + i) + xr * hi + xi * hr).copyToRawArray(acc + bins + i);
+        }
+
+        acc[0] = dc;
+        acc[bins] = nyquist;
+    }
+
+    SampleType* inputFrame(int ch) const  { return inputFrames + static_cast<size_t>(ch * 2 * partitionSize); }
+    SampleType* outputFrame(int ch) const { return outputFrames + static_cast<size_t>(ch * 2 * partitionSize); }
+
+    SampleType* spectrumAt(SampleType* base, int64_t index, int ch) const
+    {
+        return base + (static_cast<size_t>(index) * static_cast<size_t>(numChannels) + static_cast<size_t>(ch))
+                      * static_cast<size_t>(2 * partitionSize);
+    }
+
+    // out += sum over partitions [first, last) of input[forBlock - k] * impulse[k], leaving
+    // out input from before the last reset
+    void accumulate(const Kernel& k, int64_t forBlock, SampleType* out, int first, int last) const
+    {
+        const auto history = forBlock - historyStart.load(std::memory_order_relaxed) + 1;
+        last = static_cast<int>(juce::jmin(static_cast<int64_t>(last), history));
+
+        auto index = (forBlock - first) % ringSize;
+        if (index < 0)
+            index += ringSize;
+
+        for (int p = first; p < last; ++p)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                multiplyAccumulate(out + static_cast<size_t>(ch * 2 * partitionSize),
+                                   spectrumAt(ring, index, ch),
+                                   k.getPartition(juce::jmin(ch, k.numChannels - 1), p),
+                                   partitionSize);
+
+            index = index == 0 ? ringSize - 1 : index - 1;
+        }
+    }
+
+    // Publishes which kernel the calling thread reads, so setKernel() never frees it underneath
+    const Kernel* acquireKernel(std::atomic<const Kernel*>& inUse)
+    {
+        auto* k = latestKernel.load();
+        for (;;)
+        {
+            inUse.store(k);
+            auto* again = latestKernel.load();
+            if (again == k)
+                return k;
+            k = again;
+        }
+    }
+
+    void processPartition(const Kernel& k)
+    {
+        const auto frameSize = static_cast<size_t>(2 * partitionSize * numChannels);
+        const auto ringIndex = block % ringSize;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* frame = inputFrame(ch);
+            fft.fft(frame, freqScratch.data());
+            split(freqScratch.data(), spectrumAt(ring, ringIndex, ch), partitionSize);
+            std::copy(frame + partitionSize, frame + 2 * partitionSize, frame);
+        }
+
+        published.store(block, std::memory_order_release);
+
+        // A kernel built for a longer ring than this one is cut to fit
+        const auto numPartitions = juce::jmin(k.numPartitions, maxPartitions);
+        const auto head = juce::jmin(headPartitions, numPartitions);
+        auto& slot = slots[static_cast<size_t>(block % numSlots)];
+
+        if (numPartitions <= headPartitions)
+        {
+            std::fill(accumulator, accumulator + frameSize, SampleType(0));
+        }
+        else
+        {
+            worker->wake();
+
+            if (slot.target.load(std::memory_order_acquire) == block && slot.kernelVersion == k.version)
+            {
+                const auto* ready = slotSpectra + static_cast<size_t>(block % numSlots) * frameSize;
+                std::copy(ready, ready + frameSize, accumulator);
+            }
+            else
+            {
+                std::fill(accumulator, accumulator + frameSize, SampleType(0));
+                accumulate(k, block, accumulator, headPartitions, numPartitions);
+                deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // From here the worker drops anything it is still summing for this block
+        consumed.store(block, std::memory_order_release);
+
+        accumulate(k, block, accumulator, 0, head);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            interleave(accumulator + static_cast<size_t>(ch * 2 * partitionSize), freqScratch.data(), partitionSize);
+            fft.ifft(freqScratch.data(), timeScratch);
+
+            // Overlap-save: the second half is the part free of circular wrap-around
+            std::copy(timeScratch + partitionSize, timeScratch + 2 * partitionSize, outputFrame(ch));
+        }
+
+        ++block;
+    }
+
+    // Worker thread
+    bool runTailWork() override
+    {
+        const auto* k = acquireKernel(workerKernel);
+        const auto numPartitions = k != nullptr ? juce::jmin(k->numPartitions, maxPartitions) : 0;
+        if (numPartitions <= headPartitions)
+            return false;
+
+        const auto target = juce::jmax(nextTarget, consumed.load(std::memory_order_acquire) + 1);
+        if (target > published.load(std::memory_order_acquire) + headPartitions)
+            return false;
+
+        const auto frameSize = static_cast<size_t>(2 * partitionSize * numChannels);
+        auto* out = slotSpectra + static_cast<size_t>(target % numSlots) * frameSize;
+        std::fill(out, out + frameSize, SampleType(0));
+
+        nextTarget = target + 1;
+
+        for (int first = headPartitions; first < numPartitions; first += tailCheckInterval)
+        {
+            if (consumed.load(std::memory_order_acquire) >= target)
+                return true;
+
+            accumulate(*k, target, out, first, juce::jmin(first + tailCheckInterval, numPartitions));
+        }
+
+        auto& slot = slots[static_cast<size_t>(target % numSlots)];
+        slot.kernelVersion = k->version;
+        slot.target.store(target, std::memory_order_release);
+        return true;
+    }
+
+    int partitionSize = 0, numChannels = 0, maxPartitions = 0;
+    int headPartitions = minHeadPartitions, numSlots = 0;
+    int64_t ringSize = 1;
+
+    signalsmith::linear::RealFFT<SampleType> fft;
+    std::vector<Complex> freqScratch;
+
+    juce::HeapBlock<char> inputMemory, outputMemory, ringMemory, slotMemory, accumulatorMemory, timeMemory;
+    SampleType* inputFrames = nullptr;   // per channel: previous partition, then the one filling up
+    SampleType* outputFrames = nullptr;  // per channel: the partition being played out
+    SampleType* ring = nullptr;          // input spectra, ringSize blocks of every channel
+    SampleType* slotSpectra = nullptr;   // tail sums from the worker, numSlots blocks ahead
+    SampleType* accumulator = nullptr;
+    SampleType* timeScratch = nullptr;
+    std::unique_ptr<Slot[]> slots;
+
+    int fill = 0;
+    int64_t block = 0;                          // audio thread
+    int64_t nextTarget = 0;                     // worker
+    std::atomic<int64_t> published { -1 };      // newest block whose input spectrum is in the ring
+    std::atomic<int64_t> consumed { -1 };       // newest block the audio thread has output
+    std::atomic<int64_t> historyStart { 0 };    // oldest block whose input is in the ring since reset()
+    std::atomic<int> deadlineMisses { 0 };
+
+    std::shared_ptr<const Kernel> kernel;                  // message thread
+    std::vector<std::shared_ptr<const Kernel>> retired;
+    std::atomic<const Kernel*> latestKernel { nullptr };
+    std::atomic<const Kernel*> audioKernel { nullptr };
+    std::atomic<const Kernel*> workerKernel { nullptr };
+
+    juce::SharedResourcePointer<ConvolutionTailWorker> worker;
+    static inline std::atomic<uint64_t> kernelVersions { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(PartitionedConvolver)
+};
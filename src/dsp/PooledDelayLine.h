@@ -0,0 +1,193 @@
+#pragma once
+
+#include "DelayArena.h"
+
+// Same kernels as juce::dsp::DelayLineInterpolationTypes, picked at compile time per call site
+namespace DelayInterpolation
+{
+    struct Linear {};
+    struct Lagrange3rd {};
+    struct Thiran {};
+}
+
+/**
+*   Drop-in replacement for juce::dsp::DelayLine<SampleType, Linear> whose storage lives
+*   in a DelayArena instead of being owned (and reallocated) by the line itself.
+*
+*   Push/pop/setDelay behave like the JUCE line: each channel has its own read and
+*   write position, and popSample() reads relative to the read position.
+*/
+template <typename SampleType>
+class PooledDelayLine : public DelayArena::Client
+{
+public:
+    // Message thread. The arena binds memory once every line in the rack has registered.
+    void prepare(DelayArena& arena, const juce::dsp::ProcessSpec& spec, float newMaxDelaySeconds)
+    {
+        numChannels = static_cast<int>(spec.numChannels);
+        sampleRate = spec.sampleRate;
+        maxDelaySeconds = newMaxDelaySeconds;
+
+        // Unbound until the arena commits, so a reset() in between touches nothing
+        data = nullptr;
+        frames = 0;
+        writePos.clear();
+        readPos.clear();
+        allpassState.assign(static_cast<size_t>(numChannels), SampleType(0));
+
+        arena.add(*this);
+    }
+
+    void reset()
+    {
+        if (data != nullptr)
+            std::fill(data, data + frames * static_cast<size_t>(numChannels), SampleType(0));
+
+        std::fill(writePos.begin(), writePos.end(), 0);
+        std::fill(readPos.begin(), readPos.end(), 0);
+        std::fill(allpassState.begin(), allpassState.end(), SampleType(0));
+    }
+
+    void setDelay(SampleType newDelayInSamples)
+    {
+        requestedDelay = newDelayInSamples;
+
+        const auto limit = static_cast<SampleType>(maxDelayInSamples);
+        const auto clamped = juce::jlimit(SampleType(0), limit, newDelayInSamples);
+        delay = clamped;
+        delayInt = static_cast<int>(std::floor(clamped));
+        delayFrac = clamped - static_cast<SampleType>(delayInt);
+    }
+
+    [[nodiscard]] SampleType getDelay() const { return delay; }
+    [[nodiscard]] int getMaximumDelayInSamples() const { return maxDelayInSamples; }
+
+    void pushSample(int channel, SampleType sample)
+    {
+        auto& pos = writePos[static_cast<size_t>(channel)];
+        channelData(channel)[pos] = sample;
+        pos = (pos + 1) & mask;
+    }
+
+    SampleType popSample(int channel)
+    {
+        auto& pos = readPos[static_cast<size_t>(channel)];
+        const auto* buffer = channelData(channel);
+
+        const auto value1 = buffer[(pos - delayInt) & mask];
+        const auto value2 = buffer[(pos - delayInt - 1) & mask];
+        pos = (pos + 1) & mask;
+
+        return value1 + delayFrac * (value2 - value1);
+    }
+
+    // Per-call delay, for kernels that modulate each channel differently. Leaves setDelay() alone.
+    template <typename Interpolation = DelayInterpolation::Linear>
+    SampleType popSample(int channel, SampleType delayInSamples)
+    {
+        const auto limit = static_cast<SampleType>(maxDelayInSamples);
+        const auto clamped = juce::jlimit(SampleType(0), limit, delayInSamples);
+        auto whole = static_cast<int>(clamped);
+        auto frac = clamped - static_cast<SampleType>(whole);
+
+        auto& pos = readPos[static_cast<size_t>(channel)];
+        const auto* buffer = channelData(channel);
+        const auto index = pos - whole;
+        pos = (pos + 1) & mask;
+
+        if constexpr (std::is_same_v<Interpolation, DelayInterpolation::Lagrange3rd>)
+        {
+            // Centre the four taps around the read point once there is history to do so
+            const int shift = whole >= 1 ? 1 : 0;
+            frac += static_cast<SampleType>(shift);
+
+            const auto value1 = buffer[(index + shift) & mask];
+            const auto value2 = buffer[(index + shift - 1) & mask];
+            const auto value3 = buffer[(index + shift - 2) & mask];
+            const auto value4 = buffer[(index + shift - 3) & mask];
+
+            const auto d1 = frac - SampleType(1);
+            const auto d2 = frac - SampleType(2);
+            const auto d3 = frac - SampleType(3);
+
+            const auto c1 = -d1 * d2 * d3 / SampleType(6);
+            const auto c2 = d2 * d3 * SampleType(0.5);
+            const auto c3 = -d1 * d3 * SampleType(0.5);
+            const auto c4 = d1 * d2 / SampleType(6);
+
+            return value1 * c1 + frac * (value2 * c2 + value3 * c3 + value4 * c4);
+        }
+        else if constexpr (std::is_same_v<Interpolation, DelayInterpolation::Thiran>)
+        {
+            // Keep the fraction in 0.618..1.618 where the allpass coefficient behaves
+            if (frac < SampleType(0.618) && whole >= 1)
+            {
+                frac += SampleType(1);
+                --whole;
+            }
+
+            const auto value1 = buffer[(pos - 1 - whole) & mask];
+            const auto value2 = buffer[(pos - 2 - whole) & mask];
+            auto& state = allpassState[static_cast<size_t>(channel)];
+
+            const auto alpha = (SampleType(1) - frac) / (SampleType(1) + frac);
+            const auto output = frac == SampleType(0) ? value1 : value2 + alpha * (value1 - state);
+            state = output;
+
+            return output;
+        }
+        else
+        {
+            const auto value1 = buffer[index & mask];
+            const auto value2 = buffer[(index - 1) & mask];
+
+            return value1 + frac * (value2 - value1);
+        }
+    }
+
+    [[nodiscard]] size_t getRequiredFrames(double rate) const override
+    {
+        // Two guard samples for the interpolator, as in juce::dsp::DelayLine
+        return static_cast<size_t>(std::ceil(maxDelaySeconds * rate)) + 2;
+    }
+
+    [[nodiscard]] size_t getBytesPerFrame() const override
+    {
+        return sizeof(SampleType) * static_cast<size_t>(numChannels);
+    }
+
+    void bindMemory(char* memory, size_t newFrames) override
+    {
+        data = reinterpret_cast<SampleType*>(memory);
+        frames = newFrames;
+        mask = static_cast<int>(newFrames) - 1;
+        writePos.assign(static_cast<size_t>(numChannels), 0);
+        readPos.assign(static_cast<size_t>(numChannels), 0);
+        reset();
+
+        maxDelayInSamples = computeMaxDelayInSamples(frames);
+        setDelay(requestedDelay);
+    }
+
+private:
+    [[nodiscard]] int computeMaxDelayInSamples(size_t available) const
+    {
+        const auto wanted = static_cast<int>(std::ceil(maxDelaySeconds * sampleRate));
+        return juce::jmax(0, juce::jmin(wanted, static_cast<int>(available) - 2));
+    }
+
+    SampleType* channelData(int channel) const { return data + static_cast<size_t>(channel) * frames; }
+
+    SampleType* data = nullptr;
+    size_t frames = 0;
+    int mask = 0;
+    int numChannels = 0;
+    double sampleRate = 44100.0;
+    float maxDelaySeconds = 0.0f;
+    int maxDelayInSamples = 0;
+
+    std::vector<int> writePos, readPos;
+    std::vector<SampleType> allpassState;
+    SampleType requestedDelay = 0, delay = 0, delayFrac = 0;
+    int delayInt = 0;
+};
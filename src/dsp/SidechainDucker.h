@@ -0,0 +1,104 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+*   Gain curve for ducking wet returns under a sidechain signal.
+*
+*   The follower runs at control rate: each controlInterval samples of sidechain are
+*   reduced to one peak with a vectorised min/max scan, which drives an attack/release
+*   envelope. Gains between control points are linear ramps, so the per-sample work is
+*   one scan and one multiply-add per sample.
+*
+*       gain = 1 - depth * min(envelope, 1)
+*
+*   A missing or silent sidechain lets the envelope release, and once the gains are back
+*   at unity isDucking() goes false, so effects can skip the multiply.
+*/
+template <typename SampleType>
+class SidechainDucker
+{
+public:
+    static constexpr int controlInterval = 32;
+
+    // Message thread
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+        gains.resize(static_cast<size_t>(spec.maximumBlockSize));
+        std::fill(gains.begin(), gains.end(), SampleType(1));
+        updateCoefficients();
+        reset();
+    }
+
+    void reset()
+    {
+        envelope = 0;
+        lastGain = 1;
+        ducking = false;
+    }
+
+    void setAttackMs(float ms)     { attackMs = ms;  updateCoefficients(); }
+    void setReleaseMs(float ms)    { releaseMs = ms; updateCoefficients(); }
+    void setDepth(float newDepth)  { depth = juce::jlimit(0.0f, 1.0f, newDepth); }
+
+    /** Audio thread. Computes this block's gains from the sidechain, which may have no channels. */
+    void process(const juce::dsp::AudioBlock<const SampleType>& sidechain, int numSamples)
+    {
+        jassert(numSamples <= static_cast<int>(gains.size()));
+
+        const auto channels = static_cast<int>(sidechain.getNumChannels());
+        auto lowest = lastGain;
+
+        for (int start = 0; start < numSamples; start += controlInterval)
+        {
+            const auto length = juce::jmin(controlInterval, numSamples - start);
+            SampleType peak = 0;
+
+            for (int ch = 0; ch < channels; ++ch)
+            {
+                const auto range = juce::FloatVectorOperations::findMinAndMax(
+                    sidechain.getChannelPointer(static_cast<size_t>(ch)) + start, length);
+                peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+            }
+
+            const auto coefficient = peak > envelope ? attackCoefficient : releaseCoefficient;
+            envelope = peak + coefficient * (envelope - peak);
+
+            const auto target = SampleType(1) - static_cast<SampleType>(depth) * juce::jmin(envelope, SampleType(1));
+            const auto increment = (target - lastGain) / static_cast<SampleType>(length);
+
+            auto* ramp = gains.data() + start;
+            for (int i = 0; i < length; ++i)
+                ramp[i] = lastGain + increment * static_cast<SampleType>(i + 1);
+
+            lastGain = target;
+            lowest = juce::jmin(lowest, target);
+        }
+
+        ducking = lowest < SampleType(1) - unityTolerance;
+    }
+
+    // Whether this block's gains are anywhere below unity
+    [[nodiscard]] bool isDucking() const { return ducking; }
+
+    [[nodiscard]] const SampleType* getGains() const { return gains.data(); }
+
+private:
+    void updateCoefficients()
+    {
+        // One-pole time constants, stepped once per control interval
+        const auto controlRate = sampleRate / controlInterval;
+        attackCoefficient  = static_cast<SampleType>(std::exp(-1.0 / (juce::jmax(0.01f, attackMs)  * 0.001 * controlRate)));
+        releaseCoefficient = static_cast<SampleType>(std::exp(-1.0 / (juce::jmax(0.01f, releaseMs) * 0.001 * controlRate)));
+    }
+
+    static constexpr SampleType unityTolerance = SampleType(1.0e-5);
+
+    double sampleRate = 44100.0;
+    float attackMs = 5.0f, releaseMs = 150.0f, depth = 0.0f;
+    SampleType attackCoefficient = 0, releaseCoefficient = 0;
+    SampleType envelope = 0, lastGain = 1;
+    bool ducking = false;
+    std::vector<SampleType> gains;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+*   Glides the rack's randomised parameters from one snapshot to the next.
+*
+*   Every effect's randomised parameters live side by side in one packed array. A
+*   randomise step fills a previous snapshot with the current values and a next one with
+*   the new draw; from then on, each block computes
+*
+*       values = previous + (next - previous) * progress
+*
+*   as one vector pass over the whole array, and the effects read their slice of it at
+*   the top of process(). Their own smoothers fill in between blocks. An edit made while
+*   a morph runs pins that parameter with hold(), and the block a morph lands on reports
+*   hasFinished(), so the new values can be handed to the host.
+*
+*   Layout follows the DelayArena's, around RackProcessor::prepare():
+*       beginLayout()  ->  each effect calls add() from its prepare() and keeps the offset
+*       endLayout()    ->  sizes the arrays
+*/
+template <typename SampleType>
+class SnapshotMorph
+{
+public:
+    // Message thread
+    void beginLayout() { size = 0; }
+
+    int add(int numParameters)
+    {
+        const auto offset = size;
+        size += numParameters;
+        return offset;
+    }
+
+    void endLayout()
+    {
+        for (auto* snapshot : { &previous, &next, &difference, &values })
+            snapshot->assign(static_cast<size_t>(size), SampleType(0));
+
+        running = active = finished = false;
+    }
+
+    void reset() { running = active = finished = false; }
+
+    // Randomising effects write their slice of both before start()
+    [[nodiscard]] SampleType* getPrevious() { return previous.data(); }
+    [[nodiscard]] SampleType* getNext()     { return next.data(); }
+
+    /** Audio thread. Morphs over lengthInSamples, or jumps on the next block when it's 0. */
+    void start(int lengthInSamples)
+    {
+        juce::FloatVectorOperations::subtract(difference.data(), next.data(), previous.data(), size);
+        length = juce::jmax(1, lengthInSamples);
+        elapsed = 0;
+        running = true;
+    }
+
+    /** Audio thread, once per block before the effects run. */
+    void advance(int numSamples)
+    {
+        active = running;
+        finished = false;
+        if (!running)
+            return;
+
+        elapsed = juce::jmin(length, elapsed + numSamples);
+        const auto progress = static_cast<SampleType>(elapsed) / static_cast<SampleType>(length);
+
+        juce::FloatVectorOperations::copy(values.data(), previous.data(), size);
+        juce::FloatVectorOperations::addWithMultiply(values.data(), difference.data(), progress, size);
+
+        running = elapsed < length;
+        finished = !running;
+    }
+
+    /** Audio thread. Keeps one parameter at value for the rest of the morph; before the
+        first layout there is nothing to keep. */
+    void hold(int index, SampleType value)
+    {
+        if (!juce::isPositiveAndBelow(index, static_cast<int>(values.size())))
+            return;
+
+        const auto i = static_cast<size_t>(index);
+        previous[i] = next[i] = values[i] = value;
+        difference[i] = SampleType(0);
+    }
+
+    // Whether this block moved the values; effects leave their parameters alone otherwise
+    [[nodiscard]] bool isActive() const { return active; }
+
+    // Whether this block's values were the last of the morph
+    [[nodiscard]] bool hasFinished() const { return finished; }
+
+    [[nodiscard]] const SampleType* getValues() const { return values.data(); }
+
+private:
+    std::vector<SampleType> previous, next, difference, values;
+    int size = 0, length = 1, elapsed = 0;
+    bool running = false, active = false, finished = false;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "RackEffect.h"
+#include "../dsp/ImpulseResponseLibrary.h"
+
+/**
+*   Convolution reverb over a loaded impulse response. Passes audio through untouched,
+*   and adds no latency, until a response is loaded.
+*/
+template <typename SampleType>
+class ConvolutionReverbProcessor : public RackEffect<SampleType>
+{
+    public:
+        ConvolutionReverbProcessor() = default;
+
+        void prepare(const juce::dsp::ProcessSpec &spec) override
+        {
+            sampleRate = spec.sampleRate;
+
+            convolver.prepare(spec, partitionSize, maxImpulseSeconds);
+            mixer.prepare(spec);
+            mixer.setWetLatency(static_cast<SampleType>(partitionSize));
+            mixer.setWetMixProportion(mix);
+
+            // The old kernel was built for the previous rate
+            rebuildKernel();
+            wasActive = false;
+        }
+
+        void process(juce::dsp::AudioBlock<SampleType> &block) override
+        {
+            juce::dsp::ProcessContextReplacing<SampleType> context(block);
+            process(context);
+        }
+
+        void process(juce::dsp::ProcessContextReplacing<SampleType>& context) override
+        {
+            const bool active = convolver.hasKernel();
+
+            // Coming back from bypass: neither path should replay what it held back then
+            if (active && !wasActive)
+            {
+                convolver.reset();
+                mixer.reset();
+            }
+            wasActive = active;
+
+            if (!active)
+                return;
+
+            mixer.setWetMixProportion(mix);
+            mixer.pushDrySamples(context.getInputBlock());
+            convolver.process(context);
+
+            auto& wet = context.getOutputBlock();
+            if (const auto* duckGains = this->getDuckGains())
+                for (size_t ch = 0; ch < wet.getNumChannels(); ++ch)
+                    juce::FloatVectorOperations::multiply(wet.getChannelPointer(ch), duckGains, static_cast<int>(wet.getNumSamples()));
+
+            mixer.mixWetSamples(wet);
+        }
+
+        void reset() override
+        {
+            convolver.reset();
+            mixer.reset();
+        }
+
+        /** Message thread. Instances loading the same file share one kernel. */
+        bool loadImpulseResponse(const juce::File& file)
+        {
+            impulseResponse.setSize(0, 0);
+            impulseResponseFile = file;
+            rebuildKernel();
+            return convolver.hasKernel() || convolver.getPartitionSize() == 0;
+        }
+
+        /** Message thread. For responses that don't come from a file; not shared. */
+        void loadImpulseResponse(const juce::AudioBuffer<float>& impulse, double impulseSampleRate)
+        {
+            impulseResponseFile = juce::File();
+            impulseResponse.makeCopyOf(impulse);
+            impulseResponseRate = impulseSampleRate;
+            rebuildKernel();
+        }
+
+        void clearImpulseResponse()
+        {
+            impulseResponseFile = juce::File();
+            impulseResponse.setSize(0, 0);
+            convolver.setKernel(nullptr);
+        }
+
+        [[nodiscard]] const juce::File& getImpulseResponseFile() const { return impulseResponseFile; }
+
+        [[nodiscard]] bool hasImpulseResponse() const { return convolver.hasKernel(); }
+
+        [[nodiscard]] float getMix() const { return mix; }
+        void setMix(float newMix) { mix = juce::jlimit(0.0f, 1.0f, newMix); }
+
+        [[nodiscard]] int getLatencySamples() const override
+        {
+            return convolver.hasKernel() ? convolver.getLatencySamples() : 0;
+        }
+
+        std::string getName() override { return "Convolution"; };
+
+    private:
+        // Until the first prepare there is no session rate to build for
+        void rebuildKernel()
+        {
+            if (convolver.getPartitionSize() == 0)
+                return;
+
+            const auto maxPartitions = convolver.getMaxPartitions();
+
+            if (impulseResponseFile != juce::File())
+            {
+                convolver.setKernel(library->getKernel(impulseResponseFile, sampleRate, partitionSize, maxPartitions));
+            }
+            else if (impulseResponse.getNumSamples() > 0)
+            {
+                const auto conformed = ImpulseResponseLibrary<SampleType>::conform(impulseResponse, impulseResponseRate,
+                                                                                   sampleRate, maxPartitions * partitionSize);
+                convolver.setKernel(PartitionedConvolver<SampleType>::makeKernel(conformed, partitionSize, maxPartitions));
+            }
+        }
+
+        static constexpr int partitionSize = 256;
+        static constexpr float maxImpulseSeconds = 8.0f;
+
+        PartitionedConvolver<SampleType> convolver;
+        juce::dsp::DryWetMixer<SampleType> mixer { partitionSize };
+
+        juce::SharedResourcePointer<ImpulseResponseLibrary<SampleType>> library;
+        juce::File impulseResponseFile;
+        juce::AudioBuffer<float> impulseResponse;
+        double impulseResponseRate = 44100.0, sampleRate = 44100.0;
+        float mix = 0.3f;
+        bool wasActive = false;
+};
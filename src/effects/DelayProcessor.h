@@ -2,70 +2,104 @@
 
 #include <JuceHeader.h>
 #include "RackEffect.h"
+#include "../dsp/PooledDelayLine.h"
+#include "../dsp/ChannelLayout.h"
+#include "../dsp/BlockSmoother.h"
 
-class DelayProcessor: public RackEffect
+template <typename SampleType>
+class DelayProcessor: public RackEffect<SampleType>
 {
     public:
         DelayProcessor() = default;
 
         void prepare(const juce::dsp::ProcessSpec &spec) override
         {
-            delayLine.reset();
-            delayLine.prepare(spec);
+            jassert(this->delayArena != nullptr);
 
             _sampleRate = spec.sampleRate;
             numChannels = static_cast<int>(spec.numChannels);
+            channelLayout = ChannelLayout::forChannels(numChannels);
             maxDelaySamples = static_cast<float>(spec.sampleRate * maxDelaySeconds);
-            delayLine.setMaximumDelayInSamples(static_cast<int>(maxDelaySamples));
+            delayLine.prepare(*this->delayArena, spec, maxDelaySeconds);
             delayLine.setDelay(delayTimeSamples);
 
             smoothedDelay.reset(_sampleRate, 0.01f);
             smoothedFeedback.reset(_sampleRate, 0.02f);
+            smoothedDelay.prepare(static_cast<int>(spec.maximumBlockSize));
+            smoothedFeedback.prepare(static_cast<int>(spec.maximumBlockSize));
+
+            if (auto* matrix = this->modulation)
+            {
+                using Destination = typename ModulationMatrix<SampleType>::Destination;
+                matrix->addDestination(Destination::DelayTime, smoothedDelay,
+                                       static_cast<SampleType>(0.05 * _sampleRate), 1, maxDelaySamples);
+                matrix->addDestination(Destination::DelayFeedback, smoothedFeedback, 0.5f, 0, 0.95f);
+            }
+
+            this->addMorphParameters(numMorphParameters);
         }
 
-        [[nodiscard]] float getDelayTime() { return smoothedDelay.getNextValue(); }
-        [[nodiscard]] float getTargetDelayTime() { return smoothedDelay.getTargetValue(); }
+        [[nodiscard]] float getDelayTime() { return static_cast<float>(smoothedDelay.getCurrentValue()); }
+        [[nodiscard]] float getTargetDelayTime() { return static_cast<float>(smoothedDelay.getTargetValue()); }
 
         void setDelayTime(float samples)
         {
             delayTimeSamples = samples;
             smoothedDelay.setTargetValue(delayTimeSamples);
-            delayLine.setDelay(smoothedDelay.getNextValue());
+            delayLine.setDelay(smoothedDelay.getCurrentValue());
         }
 
-        void process(juce::dsp::AudioBlock<float>& block) override
+        void process(juce::dsp::AudioBlock<SampleType>& block) override
         {
             numSamples = static_cast<int>(block.getNumSamples());
-        
-            for (int ch = 0; ch < numChannels; ++ch)
+
+            if (const auto* values = this->getMorphValues())
+                applySnapshot(values);
+
+            channelLayout.dispatch([this, &block](auto channels)
             {
-                for (int i = 0; i < numSamples; ++i)
-                {
-                    in = block.getSample(ch, i);
-                    delayed = delayLine.popSample(ch);
-                    delayLine.setDelay(smoothedDelay.getNextValue());
-                    delayLine.pushSample(ch, in + (getFeedback() * delayed));
-                    block.setSample(ch, i, (mix * delayed) + (1.0f - mix) * in);
-                }
-            }
+                if constexpr (decltype(channels)::value == 2)
+                    processStereo(block);
+                else
+                    processIndependent<decltype(channels)::value>(block);
+            });
         }
 
-        void process(juce::dsp::ProcessContextReplacing<float>& context) override
+        void process(juce::dsp::ProcessContextReplacing<SampleType>& context) override
         {
             process(context.getOutputBlock());
         }
 
         void reset() override { delayLine.reset(); }
-    
+
         void setMix(float newMix) { mix = juce::jlimit(0.0f, 1.0f, newMix); }
 
-        float getFeedback() { return smoothedFeedback.getTargetValue(); }
+        float getFeedback() { return static_cast<float>(smoothedFeedback.getTargetValue()); }
         void setFeedback(float fb) { smoothedFeedback.setTargetValue(fb); }
 
+        /**
+         *  How the two delay lines feed back into each other on stereo material.
+         *  Mono layouts always use Independent.
+         */
+        enum class FeedbackMode { Independent, PingPong, CrossFeed, MidSide };
+
+        [[nodiscard]] FeedbackMode getFeedbackMode() const { return feedbackMode; }
+        void setFeedbackMode(FeedbackMode mode) { feedbackMode = mode; }
+
+        // Cross-feed proportion, or side-vs-mid feedback ratio in MidSide mode
+        [[nodiscard]] float getStereoAmount() const { return stereoAmount; }
+        void setStereoAmount(float amount) { stereoAmount = juce::jlimit(0.0f, 1.0f, amount); }
+
+        // Where each randomised parameter sits in the morph's snapshots
+        enum MorphParameter { morphDelayTime, morphFeedback, numMorphParameters };
+
         void updateRandomly(float bpm) override
         {
+            const std::array<SampleType, numMorphParameters> current { getTargetDelayTime(), getFeedback() };
+            auto drawn = current;
+
             if (feedbackRandomize)
-                setFeedback(0.3f + rand.nextFloat() * 0.5f); // 0.3 - 0.8
+                drawn[morphFeedback] = 0.3f + rand.nextFloat() * 0.5f; // 0.3 - 0.8
             if (delayTimeRandomize)
             {
                 if (bpm > 1.0f)
@@ -80,13 +114,15 @@ class DelayProcessor: public RackEffect
                     float noteLength = subdivisions[rand.nextInt(subdivisions.size())];
                     float delaySec = (60.0f / bpm) * noteLength;
         
-                    setDelayTime(delaySec * static_cast<float>(_sampleRate));
+                    drawn[morphDelayTime] = delaySec * static_cast<float>(_sampleRate);
                 }
                 else
                 {
-                    setDelayTime(rand.nextFloat() * maxDelaySamples);
+                    drawn[morphDelayTime] = rand.nextFloat() * maxDelaySamples;
                 }
             }
+
+            this->morphTo(current.data(), drawn.data(), numMorphParameters);
         }
 
         std::string getName() override { return "Delay"; };
@@ -105,12 +141,132 @@ class DelayProcessor: public RackEffect
             };
         }
 
+    protected:
+        void applySnapshot(const SampleType* values) override
+        {
+            setDelayTime(static_cast<float>(values[morphDelayTime]));
+            setFeedback(static_cast<float>(values[morphFeedback]));
+        }
+
     private:
+        // Same per-channel topology the delay always had
+        template <int Channels>
+        void processIndependent(juce::dsp::AudioBlock<SampleType>& block)
+        {
+            const auto channels = ChannelLayout::count<Channels>(numChannels);
+            const auto feedbackGains = smoothedFeedback.next(numSamples);
+            const auto delayTimes = smoothedDelay.next(numSamples);
+            const auto* duckGains = this->getDuckGains();
+
+            if (delayTimes.isConstant())
+                delayLine.setDelay(delayTimes.value);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                fb = feedbackGains[i];
+                const SampleType wetGain = duckGains != nullptr ? mix * duckGains[i] : mix;
+
+                for (int ch = 0; ch < channels; ++ch)
+                {
+                    in = block.getSample(ch, i);
+                    delayed = delayLine.popSample(ch);
+                    delayLine.pushSample(ch, in + (fb * delayed));
+                    block.setSample(ch, i, (wetGain * delayed) + (1.0f - mix) * in);
+                }
+
+                if (!delayTimes.isConstant())
+                    delayLine.setDelay(delayTimes[i]);
+            }
+        }
+
+        /**
+         *  Both channels are handled in the same iteration as one L/R frame, so the
+         *  row-major 2x2 matrices can mix them:
+         *      line = inMatrix * input + fb * fbMatrix * delayed
+         *      wet  = outMatrix * delayed
+         */
+        void processStereo(juce::dsp::AudioBlock<SampleType>& block)
+        {
+            updateMatrices();
+
+            auto* left  = block.getChannelPointer(0);
+            auto* right = block.getChannelPointer(1);
+            const auto feedbackGains = smoothedFeedback.next(numSamples);
+            const auto delayTimes = smoothedDelay.next(numSamples);
+            const auto* duckGains = this->getDuckGains();
+
+            if (delayTimes.isConstant())
+                delayLine.setDelay(delayTimes.value);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const SampleType inL = left[i], inR = right[i];
+                const SampleType dL = delayLine.popSample(0);
+                const SampleType dR = delayLine.popSample(1);
+
+                fb = feedbackGains[i];
+
+                delayLine.pushSample(0, inMatrix[0]  * inL + inMatrix[1]  * inR
+                                      + fb * (fbMatrix[0] * dL + fbMatrix[1] * dR));
+                delayLine.pushSample(1, inMatrix[2]  * inL + inMatrix[3]  * inR
+                                      + fb * (fbMatrix[2] * dL + fbMatrix[3] * dR));
+
+                const SampleType wetL = outMatrix[0] * dL + outMatrix[1] * dR;
+                const SampleType wetR = outMatrix[2] * dL + outMatrix[3] * dR;
+
+                const SampleType wetGain = duckGains != nullptr ? mix * duckGains[i] : mix;
+                left[i]  = (wetGain * wetL) + (1.0f - mix) * inL;
+                right[i] = (wetGain * wetR) + (1.0f - mix) * inR;
+
+                if (!delayTimes.isConstant())
+                    delayLine.setDelay(delayTimes[i]);
+            }
+        }
+
+        // Matrices are rebuilt per block, mode changes land on block boundaries
+        void updateMatrices()
+        {
+            const float a = stereoAmount;
+
+            switch (feedbackMode)
+            {
+                case FeedbackMode::PingPong:
+                    // Mono sum enters the left line only, repeats then alternate sides
+                    inMatrix  = { 0.5f, 0.5f, 0.0f, 0.0f };
+                    fbMatrix  = { 0.0f, 1.0f, 1.0f, 0.0f };
+                    outMatrix = { 1.0f, 0.0f, 0.0f, 1.0f };
+                    break;
+
+                case FeedbackMode::CrossFeed:
+                    inMatrix  = { 1.0f, 0.0f, 0.0f, 1.0f };
+                    fbMatrix  = { 1.0f - a, a, a, 1.0f - a };
+                    outMatrix = { 1.0f, 0.0f, 0.0f, 1.0f };
+                    break;
+
+                case FeedbackMode::MidSide:
+                {
+                    // Lines carry mid and side; side repeats decay faster as the amount grows
+                    const float side = 1.0f - a;
+                    inMatrix  = { 0.5f, 0.5f, 0.5f, -0.5f };
+                    fbMatrix  = { 1.0f, 0.0f, 0.0f, side };
+                    outMatrix = { 1.0f, 1.0f, 1.0f, -1.0f };
+                    break;
+                }
+
+                case FeedbackMode::Independent:
+                default:
+                    inMatrix  = { 1.0f, 0.0f, 0.0f, 1.0f };
+                    fbMatrix  = { 1.0f, 0.0f, 0.0f, 1.0f };
+                    outMatrix = { 1.0f, 0.0f, 0.0f, 1.0f };
+                    break;
+            }
+        }
+
         double _sampleRate = 44100.0f;
-        const float maxDelaySeconds = 3.0f;
+        float maxDelaySeconds = 3.0f;
 
         float maxDelaySamples = maxDelaySeconds * _sampleRate;
-        juce::dsp::DelayLine<float> delayLine { static_cast<int>(maxDelaySamples) };
+        PooledDelayLine<SampleType> delayLine;
         
         float delayTimeSamples = 2400.0f;
         float mix = 0.5f;
@@ -118,10 +274,15 @@ class DelayProcessor: public RackEffect
         bool feedbackRandomize = true;
         bool delayTimeRandomize = true;
 
+        FeedbackMode feedbackMode = FeedbackMode::Independent;
+        float stereoAmount = 0.3f;
+        std::array<float, 4> inMatrix {}, fbMatrix {}, outMatrix {};
+
         // Preallocating before the process loop
-        int numChannels, numSamples; float in, delayed;
+        int numChannels, numSamples; SampleType in, delayed; float fb;
+        ChannelLayout channelLayout;
         
         juce::Random rand;
-        juce::LinearSmoothedValue<float> smoothedDelay = { maxDelaySamples };
-        juce::LinearSmoothedValue<float> smoothedFeedback = { feedback };
+        BlockSmoother<SampleType> smoothedDelay = { maxDelaySamples };
+        BlockSmoother<SampleType> smoothedFeedback = { feedback };
 };
\ No newline at end of file
@@ -3,8 +3,13 @@
 
 #include <JuceHeader.h>
 #include "RackEffect.h"
+#include "../dsp/PooledDelayLine.h"
+#include "../dsp/BlockLFO.h"
+#include "../dsp/ChannelLayout.h"
+#include "../dsp/BlockSmoother.h"
 
-class FlangerProcessor : public RackEffect
+template <typename SampleType>
+class FlangerProcessor : public RackEffect<SampleType>
 {
 public:
     FlangerProcessor() = default;
@@ -13,84 +18,158 @@ public:
     {
         _sampleRate = static_cast<float>(spec.sampleRate);
         numChannels = static_cast<int>(spec.numChannels);
+        channelLayout = ChannelLayout::forChannels(numChannels);
 
-        const float maxDelayInSeconds = (maxDepth * maximumDelayModulationMs + maxCentreDelayMs) / 1000.0f;
-        const int delayBufferSize = static_cast<int>(std::ceil(_sampleRate * maxDelayInSeconds));
+        jassert(this->delayArena != nullptr);
 
-        flangerDelay = juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear>(delayBufferSize);
-        flangerDelay.prepare(spec);
+        const float maxDelayInSeconds = (maxDepth * maximumDelayModulationMs + maxCentreDelayMs) / 1000.0f;
+        flangerDelay.prepare(*this->delayArena, spec, maxDelayInSeconds);
 
         mixer.prepare(spec);
+        mixer.setWetLatency(static_cast<SampleType>(getLatencySamples()));
+        dryPathDelayed = throughZero;
         feedback.resize(numChannels);
-        lfo.prepare(spec);
+        modBuffer.setSize(numChannels, static_cast<int>(spec.maximumBlockSize));
+        feedbackGains.resize(spec.maximumBlockSize);
 
+        lfo.prepare(spec.sampleRate);
         lfo.setFrequency(lfoFreq);
-        lfo.initialise([](float val) { return std::sin(val); });
 
         smoothedDelay.reset(_sampleRate, 0.01f);
         smoothedLFODepth.reset(_sampleRate, 0.02f);
         smoothedFeedback.reset(_sampleRate, 0.04f);
+        smoothedDelay.prepare(static_cast<int>(spec.maximumBlockSize));
+        smoothedLFODepth.prepare(static_cast<int>(spec.maximumBlockSize));
+
+        if (auto* matrix = this->modulation)
+        {
+            using Destination = typename ModulationMatrix<SampleType>::Destination;
+            matrix->addDestination(Destination::FlangerDelay, smoothedDelay, maximumDelayModulationMs, 1, 20);
+            matrix->addDestination(Destination::FlangerDepth, smoothedLFODepth, 0.5f, 0, maxDepth);
+            matrix->addDestination(Destination::FlangerFeedback, smoothedFeedback, 0.5f, 0, 0.99f);
+        }
+
+        this->addMorphParameters(numMorphParameters);
+
         reset();
     }
 
     [[nodiscard]] float getAmountOfStereo() const { return stereoWidth; }
-    [[nodiscard]] float getDelay()                { return smoothedDelay.getTargetValue(); }
-    [[nodiscard]] float getLFODepth()             { return smoothedLFODepth.getTargetValue(); }
-    [[nodiscard]] float getFeedback()             { return smoothedFeedback.getTargetValue(); }
+    [[nodiscard]] float getDelay()                { return static_cast<float>(smoothedDelay.getTargetValue()); }
+    [[nodiscard]] float getLFODepth()             { return static_cast<float>(smoothedLFODepth.getTargetValue()); }
+    [[nodiscard]] float getFeedback()             { return static_cast<float>(smoothedFeedback.getTargetValue()); }
 
     void setAmountOfStereo(float newWidth) { stereoWidth = newWidth; }
     void setDelay(float newCentreDelayMs)  { smoothedDelay.setTargetValue(newCentreDelayMs); }
     void setLFODepth(float newLfoDepth)    { smoothedLFODepth.setTargetValue(newLfoDepth); }
     void setFeedback(float newFeedback)    { smoothedFeedback.setTargetValue(newFeedback); }
 
-    void process(juce::dsp::AudioBlock<float> &block) override
+    using LFOShape = typename BlockLFO<SampleType>::Shape;
+
+    [[nodiscard]] LFOShape getLFOShape() const { return lfo.getShape(); }
+    void setLFOShape(LFOShape shape)           { lfo.setShape(shape); }
+
+    enum class Interpolation { Linear, Lagrange, Allpass };
+
+    [[nodiscard]] Interpolation getInterpolation() const { return interpolation; }
+    void setInterpolation(Interpolation newInterpolation) { interpolation = newInterpolation; }
+
+    /**
+     *  Through-zero: the dry path is held back by a fixed reference delay and the wet
+     *  delay sweeps either side of it, so the two cross at zero relative delay. The
+     *  centre delay is not used in this mode; depth scales the sweep around the reference.
+     */
+    [[nodiscard]] bool getThroughZero() const { return throughZero; }
+    void setThroughZero(bool shouldBeThroughZero) { throughZero = shouldBeThroughZero; }
+
+    [[nodiscard]] int getLatencySamples() const override
+    {
+        return throughZero ? juce::roundToInt(throughZeroReferenceMs * _sampleRate / 1000.0f) : 0;
+    }
+
+    void process(juce::dsp::AudioBlock<SampleType> &block) override
     {
-        juce::dsp::ProcessContextReplacing<float> context(block);
+        juce::dsp::ProcessContextReplacing<SampleType> context(block);
         inputBlock =  &context.getInputBlock();
         outputBlock = &context.getOutputBlock();
         numSamples = static_cast<int>(outputBlock->getNumSamples());
 
-        mixer.pushDrySamples(*inputBlock);
-
-        for (int channel = 0; channel < numChannels; ++channel) {
+        if (const auto* values = this->getMorphValues())
+            applySnapshot(values);
 
-            phaseOffset = (channel == 1) ? juce::MathConstants<float>::halfPi * getAmountOfStereo() : 0.0f;
+        if (throughZero != dryPathDelayed) {
+            mixer.setWetLatency(static_cast<SampleType>(getLatencySamples()));
+            dryPathDelayed = throughZero;
+        }
 
-            for (int i = 0; i < numSamples; ++i) {
-                input = inputBlock->getSample(channel, i);
+        mixer.pushDrySamples(*inputBlock);
 
-                lfoValue = lfo.processSample(phaseOffset);
-                delayCalcMs = juce::jlimit(1.0f, 20.0f, smoothedDelay.getNextValue() + (lfoValue * smoothedLFODepth.getNextValue()));
-                delayCalcSamples = delayCalcMs * (_sampleRate / 1000.0f);
-                flangerDelay.setDelay(delayCalcSamples);
+        // Right channel trails by up to a quarter cycle
+        jassert(numSamples <= modBuffer.getNumSamples());
+        lfo.setPhaseOffset(1, 0.25f * getAmountOfStereo());
+        lfo.process(modBuffer.getArrayOfWritePointers(), numChannels, numSamples);
 
-                inputWithFeedback = input + feedback[channel];
-                flangerDelay.pushSample(channel, inputWithFeedback);
-                wetSignal = flangerDelay.popSample(channel);
+        // Shared by every channel; settled ones come back as scalars
+        const auto centre = smoothedDelay.next(numSamples);
+        const auto depth = smoothedLFODepth.next(numSamples);
+        smoothedFeedback.fill(feedbackGains.data(), numSamples);
 
-                outputBlock->setSample(channel, i, wetSignal);
-                feedback[channel] = wetSignal * smoothedFeedback.getNextValue();
+        for (int channel = 0; channel < numChannels; ++channel) {
+            delaySamples = modBuffer.getWritePointer(channel);
+            if (depth.isConstant())
+                juce::FloatVectorOperations::multiply(delaySamples, depth.value, numSamples);
+            else
+                juce::FloatVectorOperations::multiply(delaySamples, depth.ramp, numSamples);
+
+            if (throughZero) {
+                // LFO block -> reference +/- reference, in samples
+                const auto reference = static_cast<float>(getLatencySamples());
+                juce::FloatVectorOperations::multiply(delaySamples, reference, numSamples);
+                juce::FloatVectorOperations::add(delaySamples, reference, numSamples);
+                juce::FloatVectorOperations::clip(delaySamples, delaySamples, 0.0f, 2.0f * reference, numSamples);
+            } else {
+                // LFO block -> delay times in samples, clamped to 1-20 ms
+                if (centre.isConstant())
+                    juce::FloatVectorOperations::add(delaySamples, centre.value, numSamples);
+                else
+                    juce::FloatVectorOperations::add(delaySamples, centre.ramp, numSamples);
+                juce::FloatVectorOperations::clip(delaySamples, delaySamples, 1.0f, 20.0f, numSamples);
+                juce::FloatVectorOperations::multiply(delaySamples, _sampleRate / 1000.0f, numSamples);
             }
         }
 
+        // The interpolation kernel is chosen once per block, never inside the sample loop
+        switch (interpolation) {
+            case Interpolation::Lagrange: processWith<DelayInterpolation::Lagrange3rd>(); break;
+            case Interpolation::Allpass:  processWith<DelayInterpolation::Thiran>();      break;
+            case Interpolation::Linear:
+            default:                      processWith<DelayInterpolation::Linear>();      break;
+        }
+
         mixer.mixWetSamples(*outputBlock);
     }
 
-    void process(juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
         process(context.getOutputBlock());
     }
 
     void reset() override
     {
-        std::fill(feedback.begin(), feedback.end(), static_cast<float>(0));
+        std::fill(feedback.begin(), feedback.end(), static_cast<SampleType>(0));
         flangerDelay.reset();
         lfo.reset();
         mixer.reset();
     }
 
+    // Where each randomised parameter sits in the morph's snapshots
+    enum MorphParameter { morphCentreDelay, morphDepth, morphFeedback, numMorphParameters };
+
     void updateRandomly(float bpm) override
     {
+        const std::array<SampleType, numMorphParameters> current { getDelay(), getLFODepth(), getFeedback() };
+        auto drawn = current;
+
         if (delayRandomize)
         {                
             if (bpm > 1.0f)
@@ -118,22 +197,24 @@ public:
                 {
                     float chosenSubdivision = validSubdivisions[rand.nextInt(validSubdivisions.size())];
                     float delayMs = (60.0f / bpm) * chosenSubdivision * 1000.0f;
-                    setDelay(delayMs);
+                    drawn[morphCentreDelay] = delayMs;
                 }
                 else
                 {
-                    setDelay(rand.nextFloat() * maxCentreDelayMs);
+                    drawn[morphCentreDelay] = rand.nextFloat() * maxCentreDelayMs;
                 }
             }
             else
             {
-                setDelay(rand.nextFloat() * maxCentreDelayMs);
+                drawn[morphCentreDelay] = rand.nextFloat() * maxCentreDelayMs;
             }
         }
         if (depthRandomize)
-            setLFODepth(juce::Random::getSystemRandom().nextFloat() * maxDepth);
+            drawn[morphDepth] = juce::Random::getSystemRandom().nextFloat() * maxDepth;
         if (feedbackRandomize)
-            setFeedback(juce::Random::getSystemRandom().nextFloat());
+            drawn[morphFeedback] = juce::Random::getSystemRandom().nextFloat();
+
+        this->morphTo(current.data(), drawn.data(), numMorphParameters);
     }
 
     std::string getName() override { return "Flanger"; };
@@ -155,12 +236,95 @@ public:
         };
     }
 
+protected:
+    void applySnapshot(const SampleType* values) override
+    {
+        setDelay(static_cast<float>(values[morphCentreDelay]));
+        setLFODepth(static_cast<float>(values[morphDepth]));
+        setFeedback(static_cast<float>(values[morphFeedback]));
+    }
+
 private:
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> flangerDelay;
-    juce::dsp::Oscillator<float> lfo;
+    template <typename Kernel>
+    void processWith()
+    {
+        channelLayout.dispatch([this](auto channels)
+        {
+            if constexpr (decltype(channels)::value == ChannelLayout::runtime)
+                processChannels<Kernel>();
+            else
+                processFrames<Kernel, decltype(channels)::value>();
+        });
+    }
+
+    /**
+     *  Mono and stereo run a frame per iteration with the channels as lanes: the same
+     *  operations on each value, with nothing crossing between them, so the compiler can
+     *  pack L and R together.
+     */
+    template <typename Kernel, int Channels>
+    void processFrames()
+    {
+        const SampleType* delays[Channels];
+        const SampleType* in[Channels];
+        SampleType* out[Channels];
+        SampleType state[Channels], wet[Channels];
+        const SampleType* feedbackGain = feedbackGains.data();
+
+        for (int ch = 0; ch < Channels; ++ch) {
+            delays[ch] = modBuffer.getReadPointer(ch);
+            in[ch] = inputBlock->getChannelPointer(static_cast<size_t>(ch));
+            out[ch] = outputBlock->getChannelPointer(static_cast<size_t>(ch));
+            state[ch] = feedback[static_cast<size_t>(ch)];
+        }
+
+        for (int i = 0; i < numSamples; ++i) {
+            for (int ch = 0; ch < Channels; ++ch)
+                flangerDelay.pushSample(ch, in[ch][i] + state[ch]);
+
+            for (int ch = 0; ch < Channels; ++ch)
+                wet[ch] = flangerDelay.template popSample<Kernel>(ch, delays[ch][i]);
+
+            for (int ch = 0; ch < Channels; ++ch) {
+                out[ch][i] = wet[ch];
+                state[ch] = wet[ch] * feedbackGain[i];
+            }
+        }
+
+        for (int ch = 0; ch < Channels; ++ch)
+            feedback[static_cast<size_t>(ch)] = state[ch];
+    }
+
+    // Fallback for layouts wider than stereo
+    template <typename Kernel>
+    void processChannels()
+    {
+        const SampleType* feedbackGain = feedbackGains.data();
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            delaySamples = modBuffer.getWritePointer(channel);
+
+            for (int i = 0; i < numSamples; ++i) {
+                input = inputBlock->getSample(channel, i);
+
+                inputWithFeedback = input + feedback[channel];
+                flangerDelay.pushSample(channel, inputWithFeedback);
+                wetSignal = flangerDelay.template popSample<Kernel>(channel, delaySamples[i]);
+
+                outputBlock->setSample(channel, i, wetSignal);
+                feedback[channel] = wetSignal * feedbackGain[i];
+            }
+        }
+    }
+
+    PooledDelayLine<SampleType> flangerDelay;
+    BlockLFO<SampleType> lfo;
+    juce::AudioBuffer<SampleType> modBuffer;
+    std::vector<SampleType> feedbackGains;
 
     float _sampleRate = 44100.0f;
     int numChannels = 0, numSamples;
+    ChannelLayout channelLayout;
 
     float lfoDepth = 5.0f;
     float lfoFreq = 0.33f;
@@ -170,19 +334,27 @@ private:
     float maxCentreDelayMs = 15.0f;
     float maximumDelayModulationMs = 5.0f;
 
+    // Wet sweeps 0..2x this in through-zero mode; also the reported latency
+    static constexpr float throughZeroReferenceMs = 5.0f;
+    // Dry-path headroom for the reference delay, enough for 5 ms up to 768 kHz
+    static constexpr int maxWetLatencySamples = 4096;
+
+    Interpolation interpolation = Interpolation::Linear;
+    bool throughZero = false, dryPathDelayed = false;
+
     // Preallocations ahead of the process loop:
-    float wetSignal, inputWithFeedback, lfoValue, delayCalcMs,
-                    delayCalcSamples, input, phaseOffset;
-    const juce::dsp::AudioBlock<const float> *inputBlock;
-    juce::dsp::AudioBlock<float> *outputBlock;
+    SampleType wetSignal, inputWithFeedback, input;
+    SampleType* delaySamples;
+    const juce::dsp::AudioBlock<const SampleType> *inputBlock;
+    juce::dsp::AudioBlock<SampleType> *outputBlock;
 
-    std::vector<float> feedback{0.5f};
+    std::vector<SampleType> feedback{0.5f};
     juce::Random rand;
 
-    juce::dsp::DryWetMixer<float> mixer;
-    juce::LinearSmoothedValue<float> smoothedDelay = { maxCentreDelayMs };
-    juce::LinearSmoothedValue<float> smoothedLFODepth = { lfoDepth };
-    juce::LinearSmoothedValue<float> smoothedFeedback = { feedback[0] };
+    juce::dsp::DryWetMixer<SampleType> mixer { maxWetLatencySamples };
+    BlockSmoother<SampleType> smoothedDelay = { maxCentreDelayMs };
+    BlockSmoother<SampleType> smoothedLFODepth = { lfoDepth };
+    BlockSmoother<SampleType> smoothedFeedback = { feedback[0] };
 
     bool delayRandomize = true;
     bool depthRandomize = true;
@@ -1,18 +1,87 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "../dsp/DelayArena.h"
+#include "../dsp/SidechainDucker.h"
+#include "../dsp/ModulationMatrix.h"
+#include "../dsp/SnapshotMorph.h"
 
+// Effects are built for float or double processing; the plugin holds a rack of each
+template <typename SampleType>
 class RackEffect
 {
     public:
         virtual ~RackEffect() = default;
 
         virtual void prepare(const juce::dsp::ProcessSpec& spec) = 0;
-        virtual void process(juce::dsp::AudioBlock<float>& block) = 0;
-        virtual void process(juce::dsp::ProcessContextReplacing<float>& context) = 0;
+        virtual void process(juce::dsp::AudioBlock<SampleType>& block) = 0;
+        virtual void process(juce::dsp::ProcessContextReplacing<SampleType>& context) = 0;
         virtual void reset() {}
         virtual void updateRandomly(float bpm) {}
         virtual std::string getName() { return nullptr; }
         [[nodiscard]] virtual bool getParallel() const { return false; }
         [[nodiscard]] virtual std::map<std::string, float> getParameterMap() { return {}; }
+        // Samples of delay the effect adds to the signal path, reported to the host
+        [[nodiscard]] virtual int getLatencySamples() const { return 0; }
+
+        // Effects with delay lines take their memory from the rack's arena
+        void setDelayArena(DelayArena* arena) { delayArena = arena; }
+
+        // Effects with a wet return the sidechain can duck get the rack's ducker
+        void setDucker(const SidechainDucker<SampleType>* newDucker) { ducker = newDucker; }
+
+        // Effects with modulatable parameters register their smoothers with it from prepare()
+        void setModulationMatrix(ModulationMatrix<SampleType>* matrix) { modulation = matrix; }
+
+        // Effects with randomised parameters glide between the rack's snapshots
+        void setSnapshotMorph(SnapshotMorph<SampleType>* newMorph) { morph = newMorph; }
+
+        // Audio thread, after setting one of them directly: a morph in flight leaves it there
+        void holdMorphParameter(int index, SampleType value)
+        {
+            if (morph != nullptr)
+                morph->hold(morphOffset + index, value);
+        }
+
+    protected:
+        // This block's gains for the wet signal, or nullptr when nothing is ducking it
+        [[nodiscard]] const SampleType* getDuckGains() const
+        {
+            return ducker != nullptr && ducker->isDucking() ? ducker->getGains() : nullptr;
+        }
+
+        // From prepare(): claims this effect's slice of the snapshots
+        void addMorphParameters(int count)
+        {
+            if (morph != nullptr)
+                morphOffset = morph->add(count);
+        }
+
+        // From updateRandomly(). Without a morph to glide through, the drawn values apply at once.
+        void morphTo(const SampleType* current, const SampleType* drawn, int count)
+        {
+            if (morph == nullptr)
+            {
+                applySnapshot(drawn);
+                return;
+            }
+
+            std::copy(current, current + count, morph->getPrevious() + morphOffset);
+            std::copy(drawn, drawn + count, morph->getNext() + morphOffset);
+        }
+
+        // This block's values for the slice, or nullptr when no morph is moving them
+        [[nodiscard]] const SampleType* getMorphValues() const
+        {
+            return morph != nullptr && morph->isActive() ? morph->getValues() + morphOffset : nullptr;
+        }
+
+        // Sets the randomised parameters from a slice, in the order updateRandomly() packs them
+        virtual void applySnapshot(const SampleType* /*values*/) {}
+
+        DelayArena* delayArena = nullptr;
+        const SidechainDucker<SampleType>* ducker = nullptr;
+        ModulationMatrix<SampleType>* modulation = nullptr;
+        SnapshotMorph<SampleType>* morph = nullptr;
+        int morphOffset = 0;
 };
\ No newline at end of file
@@ -0,0 +1,50 @@
+// Checks that the bundled FFT's SSE2 and AVX2 kernels give the scalar kernels' results, for every
+// level this machine supports, in float and double. Exits non-zero on any mismatch.
+//
+// This lives here rather than in the plugin because the check switches the process-wide kernel
+// level while it runs, which would change it under every other instance's audio thread.
+
+#include <fft.h>
+
+#include <cstdio>
+
+int main()
+{
+#ifdef SIGNALSMITH_AUDIO_LINEAR_FFT_X86_H
+    using signalsmith::linear::_impl::simd::Level;
+    auto& level = signalsmith::linear::_impl::simd::level();
+    const auto detected = level.load();
+
+    struct Candidate
+    {
+        Level level;
+        const char* name;
+    };
+    const Candidate candidates[] = { { Level::sse2, "sse2" }, { Level::avx2, "avx2" } };
+
+    bool allMatch = true;
+    for (const auto& candidate : candidates)
+    {
+        if (candidate.level > detected)
+        {
+            std::printf("%-5s not supported here, skipped\n", candidate.name);
+            continue;
+        }
+
+        level.store(candidate.level);
+        const bool floatMatches = signalsmith::linear::simdMatchesReference<float>();
+        level.store(candidate.level);
+        const bool doubleMatches = signalsmith::linear::simdMatchesReference<double>();
+
+        std::printf("%-5s float %s, double %s\n", candidate.name,
+                    floatMatches ? "ok" : "MISMATCH", doubleMatches ? "ok" : "MISMATCH");
+        allMatch = allMatch && floatMatches && doubleMatches;
+    }
+
+    level.store(detected);
+    return allMatch ? 0 : 1;
+#else
+    std::printf("no x86 kernels in this build, nothing to check\n");
+    return 0;
+#endif
+}